@@ -34,9 +34,11 @@
 // DPL (Driver Porting Layer) SystemP has a vsnprintf() implementation
 #include <ti/drivers/dpl/SystemP.h>
 #include <ti/drivers/dpl/SemaphoreP.h>
+#include <ti/drivers/dpl/ClockP.h>
 
 #include "spitxn.h"
 #include "ste2007.h"
+#include "ste2007_font.h"
 #include "font_5x7.h"
 
 
@@ -46,6 +48,44 @@ int ste2007_control_mutexwrapped(Display_Handle, unsigned int, void *);
 int ste2007_control(Display_Handle, unsigned int, void *);
 void ste2007_close(Display_Handle);
 void ste2007_vprintf(Display_Handle, uint8_t, uint8_t, char *, va_list);
+static void ste2007_clear_nolock(Display_Handle);
+static void ste2007_clearLines_nolock(Display_Handle, uint8_t, uint8_t);
+static void ste2007_clearspan_nolock(Display_Handle, uint8_t, uint8_t, uint32_t);
+static void ste2007_vprintf_nolock(Display_Handle, uint8_t, uint8_t, const char *, va_list);
+static bool ste2007_shadow_record(DisplayNokia1202_Object *, const uint16_t *, uint32_t);
+static int ste2007_frame_commit(Display_Handle);
+#ifdef NOKIA1202_TRACE
+void ste2007_trace_record(Display_Handle, uint16_t type, const uint16_t *words, uint32_t count);
+#endif
+
+//! @brief font_5x7 described for ste2007_drawtext(); glyphs start at ' ' and anything outside the table draws a space
+const DisplayNokia1202_Font ste2007_font5x7 = {
+    .pages = 1,
+    .first = 32,
+    .last = 32 + sizeof(font_5x7) / sizeof(font_5x7[0]) - 1,
+    .defaultGlyph = 0,
+    .fixedWidth = sizeof(font_5x7[0]),
+    .index = NULL,
+    .offset = NULL,
+    .bitmap = &font_5x7[0][0],
+    .tagged = NULL
+};
+
+//! @brief One DDRAM row of blank data words; clears are sent straight from here and never touch the row buffer
+static const uint16_t ste2007_zerorow[STE2007_COLUMNS] = {
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100
+};
 
 //! @brief Driver FxnTable
 const Display_FxnTable DisplayNokia1202_FxnTable = {
@@ -75,6 +115,156 @@ void ste2007_chipselect(Display_Handle dpyH, uint8_t onoff)
     const DisplayNokia1202_HWAttrsV1 *h = dpyH->hwAttrs;
 
     GPIO_write(h->csPin, onoff);
+#ifdef NOKIA1202_TRACE
+    ste2007_trace_record(dpyH, (onoff ? NOKIA1202_TRACE_CS_RELEASE : NOKIA1202_TRACE_CS_ASSERT), NULL, 0);
+#endif
+}
+
+#ifdef NOKIA1202_TRACE
+//! @brief Append one word to the SPI trace ring, overwriting the oldest word once it is full
+static inline void ste2007_trace_put(DisplayNokia1202_Trace *t, uint16_t w)
+{
+    t->buf[t->head++] = w;
+    if (t->head >= t->cap) {
+        t->head = 0;
+        t->wraps++;
+    }
+}
+
+/**
+ * @brief Append one record to the SPI trace ring, if one has been attached with NOKIA1202_CMD_TRACE
+ * @details Record layout (all uint16_t words): <type> <ticks bits 0-14> <ticks bits 15-29> [<count> <count words...>]
+ *          Only the <type> marker word has bit 15 set, so a reader can resynchronize after the ring wraps over
+ *          a partially overwritten record.
+ */
+void ste2007_trace_record(Display_Handle dpyH, uint16_t type, const uint16_t *words, uint32_t count)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    DisplayNokia1202_Trace *t = o->trace;
+    uint32_t ticks, i;
+
+    if (t == NULL || t->buf == NULL || t->cap == 0) {
+        return;
+    }
+    ticks = ClockP_getSystemTicks();
+
+    ste2007_trace_put(t, type);
+    ste2007_trace_put(t, ticks & 0x7FFF);
+    ste2007_trace_put(t, (ticks >> 15) & 0x7FFF);
+    if (type == NOKIA1202_TRACE_XFER) {
+        ste2007_trace_put(t, count & 0x7FFF);
+        for (i=0; i < count; i++) {
+            ste2007_trace_put(t, words[i] & 0x7FFF);
+        }
+    }
+}
+#endif
+
+//! @brief Every SPI_transfer the driver performs goes through here so it can be captured by the optional trace hook
+//! @details Once a transfer has failed (timed out), the rest of the operation's transfers are skipped rather than
+//!          queued onto a stuck bus; ste2007_lock() clears the condition for the next operation.
+void ste2007_spitransfer(Display_Handle dpyH, SPI_Transaction *txn)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    if (o->txnFailed) {
+        return;
+    }
+    if (o->shadow != NULL && ste2007_shadow_record(o, (const uint16_t *)txn->txBuf, txn->count) && o->frameOpen) {
+        return;  // Frame in progress; DDRAM data only goes to the shadow until it is committed
+    }
+#ifdef NOKIA1202_TRACE
+    ste2007_trace_record(dpyH, NOKIA1202_TRACE_XFER, (const uint16_t *)txn->txBuf, txn->count);
+#endif
+    if (!SPI_transfer(o->bus, txn)) {
+        o->txnFailed = true;
+        o->curX = STE2007_SHADOW_UNKNOWN;  // No telling how much of it reached the chip
+        o->curY = STE2007_SHADOW_UNKNOWN;
+        if (txn->count > 0 && (((const uint16_t *)txn->txBuf)[0] & 0x0100)) {
+            o->shadowStale = (1 << STE2007_PAGES) - 1;  // Nor how much of the data the shadow now holds did
+        }
+    }
+}
+
+/**
+ * @brief Copy the DDRAM data words of a transfer into the shadow framebuffer at the tracked cursor
+ * @details Every transfer in this driver is either all command words or all data words, so only the first word's tag
+ *          is checked.  Data sent while the cursor is unknown (only after an SPI failure) cannot be placed, so every
+ *          page is marked stale instead; a page stops being stale once one transfer outside a frame covers all of its
+ *          columns.  While a frame is open, bytes that change are also marked dirty in their page.
+ * @return true if this was a DDRAM data transfer
+ */
+static bool ste2007_shadow_record(DisplayNokia1202_Object *o, const uint16_t *words, uint32_t count)
+{
+    uint32_t i, pos;
+    uint8_t b, x, y;
+
+    if (count == 0 || !(words[0] & 0x0100)) {
+        return false;
+    }
+    if (o->curX == STE2007_SHADOW_UNKNOWN || o->curY == STE2007_SHADOW_UNKNOWN) {
+        o->shadowStale = (1 << STE2007_PAGES) - 1;
+        return true;
+    }
+    x = o->curX;
+    y = o->curY;
+    pos = (uint32_t)y * STE2007_COLUMNS + x;
+    for (i=0; i < count && pos < NOKIA1202_SHADOW_SIZE; i++, pos++) {
+        b = (uint8_t)words[i];
+        if (o->frameOpen && o->shadow[pos] != b) {
+            if (x < o->dirtyLo[y]) {
+                o->dirtyLo[y] = x;
+            }
+            if (x > o->dirtyHi[y]) {
+                o->dirtyHi[y] = x;
+            }
+            o->dirtyCols[y][x >> 3] |= 1 << (x & 7);
+        }
+        o->shadow[pos] = b;
+        if (x == STE2007_COLUMNS - 1 && i >= x && !o->frameOpen) {
+            o->shadowStale &= ~(1 << y);  // This transfer rewrote the whole page
+        }
+        if (++x == STE2007_COLUMNS) {
+            x = 0;
+            y++;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Take the display's mutex, waiting at most <timeout> ClockP ticks
+ * @details NOKIA1202_TIMEOUT_DEFAULT uses the mutexTimeout from the HWAttrs.  If the previous operation hit an SPI
+ *          timeout, the shadow registers can no longer be trusted and are invalidated here.
+ * @return DISPLAY_STATUS_SUCCESS, NOKIA1202_STATUS_BUSY (timeout was 0) or NOKIA1202_STATUS_TIMEOUT
+ */
+int ste2007_lock(Display_Handle dpyH, uint32_t timeout)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    const DisplayNokia1202_HWAttrsV1 *h = dpyH->hwAttrs;
+
+    if (timeout == NOKIA1202_TIMEOUT_DEFAULT) {
+        timeout = (h->mutexTimeout == 0) ? SemaphoreP_WAIT_FOREVER : h->mutexTimeout;
+    }
+    if (SemaphoreP_pend(o->mutex, timeout) != SemaphoreP_OK) {
+        return (timeout == SemaphoreP_NO_WAIT) ? NOKIA1202_STATUS_BUSY : NOKIA1202_STATUS_TIMEOUT;
+    }
+    if (o->txnFailed) {
+        ste2007_invalidate(dpyH);
+        o->txnFailed = false;
+    }
+    return DISPLAY_STATUS_SUCCESS;
+}
+
+//! @brief Release the display's mutex
+//! @return DISPLAY_STATUS_SUCCESS, or NOKIA1202_STATUS_TIMEOUT if an SPI transfer timed out while it was held
+int ste2007_unlock(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    int ret = o->txnFailed ? NOKIA1202_STATUS_TIMEOUT : DISPLAY_STATUS_SUCCESS;
+
+    SemaphoreP_post(o->mutex);
+    return ret;
 }
 
 //! @brief Send a simple 1-byte command
@@ -93,8 +283,12 @@ void ste2007_issuecmd(Display_Handle dpyH, uint8_t cmd, uint8_t arg, uint8_t arg
     txn.rxBuf = 0;
 
     ste2007_chipselect(dpyH, 0);
-    SPI_transfer(o->bus, &txn);
+    ste2007_spitransfer(dpyH, &txn);
     ste2007_chipselect(dpyH, 1);
+
+    if (c == STE2007_CMD_RESET) {
+        ste2007_invalidate(dpyH);  // Soft reset puts every register back to its power-on default
+    }
 }
 
 //! @brief Send a more complex 2-byte command
@@ -114,10 +308,49 @@ void ste2007_issue_compoundcmd(Display_Handle dpyH, uint8_t cmd, uint8_t arg, ui
     txn.rxBuf = 0;
 
     ste2007_chipselect(dpyH, 0);
-    SPI_transfer(o->bus, &txn);
+    ste2007_spitransfer(dpyH, &txn);
     ste2007_chipselect(dpyH, 1);
 }
 
+/**
+ * @brief Forget everything the shadow registers claim to know about the controller
+ * @details The next setxy/contrast/invert/etc. call after this will always be sent to the chip.
+ */
+void ste2007_invalidate(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    o->curX = STE2007_SHADOW_UNKNOWN;
+    o->curY = STE2007_SHADOW_UNKNOWN;
+    o->contrast = STE2007_SHADOW_UNKNOWN;
+    o->orientation = STE2007_SHADOW_UNKNOWN;
+    o->startline = STE2007_SHADOW_UNKNOWN;
+    o->invert = STE2007_SHADOW_UNKNOWN;
+    o->powersave = STE2007_SHADOW_UNKNOWN;
+    o->refreshrate = STE2007_SHADOW_UNKNOWN;
+    o->backlight = STE2007_SHADOW_UNKNOWN;
+}
+
+//! @brief Track the STE2007's column auto-increment after <len> DDRAM data words have been written
+//! @details The column wraps to the start of the next page at the end of the 96-pixel row; running off the last page
+//!          leaves the cursor in an unknown state.
+void ste2007_advancecursor(Display_Handle dpyH, uint32_t len)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    uint32_t x;
+
+    if (o->curX == STE2007_SHADOW_UNKNOWN || o->curY == STE2007_SHADOW_UNKNOWN) {
+        return;
+    }
+    x = o->curX + len;
+    o->curY += x / STE2007_COLUMNS;
+    o->curX = x % STE2007_COLUMNS;
+    if (o->curY >= STE2007_PAGES) {
+        o->curX = STE2007_SHADOW_UNKNOWN;
+        o->curY = STE2007_SHADOW_UNKNOWN;
+    }
+}
+
 //! @brief TI Display_init() handler - can run outside of RTOS runtime
 void ste2007_init(Display_Handle dpyH)
 {
@@ -129,6 +362,22 @@ void ste2007_init(Display_Handle dpyH)
     o->rowbuffer.buf = o->_rowBuf;
     o->rowbuffer.cap = 16*6;
     o->rowbuffer.len = 0;
+    o->txnFailed = false;
+    ste2007_invalidate(dpyH);
+    o->gray = NULL;
+    o->grayPages = 0;
+    o->grayPhase = 0;
+    o->grayClock = NULL;
+    o->graySem = NULL;
+    o->shadow = NULL;
+    o->shadowStale = (1 << STE2007_PAGES) - 1;
+    o->scrubPage = 0;
+    o->scrubPermille = 0;
+    o->scrubCredit = 0;
+    o->scrubTick = 0;
+    o->frameOpen = false;
+    ste2007_frame_clean(dpyH);
+    o->trace = NULL;
 }
 
 /** @brief Logical LCD operations
@@ -164,10 +413,10 @@ Display_Handle ste2007_open(Display_Handle dpyH, Display_Params *params)
 
     SPI_Params_init(&spiP);
     spiP.transferMode = SPI_MODE_BLOCKING;
-    spiP.transferTimeout = SPI_WAIT_FOREVER;
+    spiP.transferTimeout = (h->transferTimeout == 0) ? SPI_WAIT_FOREVER : h->transferTimeout;
     spiP.mode = SPI_MASTER;
     spiP.dataSize = 9;
-    spiP.bitRate = 1000000;  // 1MHz
+    spiP.bitRate = NOKIA1202_SPI_BITRATE;
     spiP.frameFormat = SPI_POL0_PHA0;  // Mode 0
     o->bus = SPI_open(h->spiBus, &spiP);
     if (o->bus == NULL) {
@@ -179,21 +428,33 @@ Display_Handle ste2007_open(Display_Handle dpyH, Display_Params *params)
     ste2007_issuecmd(dpyH, STE2007_CMD_DPYALLPTS, 0, STE2007_MASK_DPYALLPTS); // Powersave ALLPOINTS-ON mode turned OFF
     ste2007_issuecmd(dpyH, STE2007_CMD_PWRCTL, 7, STE2007_MASK_PWRCTL); // Power control set to max
     ste2007_issuecmd(dpyH, STE2007_CMD_ONOFF, 1, STE2007_MASK_ONOFF); // Display ON
-    ste2007_issuecmd(dpyH, STE2007_CMD_COMDIR, 0, STE2007_MASK_COMDIR); // Display common driver = NORMAL
-    ste2007_issuecmd(dpyH, STE2007_CMD_SEGMENTDIR, 0, STE2007_MASK_SEGMENTDIR); // Lines start at the left
+    ste2007_orientation(dpyH, h->orientation); // Common/segment driver direction, NORMAL unless HWAttrs say otherwise
+    ste2007_startline(dpyH, 0); // DDRAM row 0 at the top of the panel
     ste2007_issuecmd(dpyH, STE2007_CMD_ELECTVOL, 16, STE2007_MASK_ELECTVOL); // Electronic volume set to 16
 
-    // Need to release the mutex since ste2007_clear() uses it
-    SemaphoreP_post(o->mutex);
-    ste2007_clear(dpyH);
-    SemaphoreP_pend(o->mutex, SemaphoreP_WAIT_FOREVER);
+    // The clear below fills the shadow framebuffer too
+    o->shadow = h->shadowBuf;
+    o->shadowStale = (1 << STE2007_PAGES) - 1;
+    o->scrubPage = 0;
+    o->scrubPermille = (h->shadowBuf != NULL && h->scrubPermille <= 1000) ? h->scrubPermille : 0;
+    o->scrubCredit = 0;
+    o->scrubTick = ClockP_getSystemTicks();
+
+    ste2007_clear_nolock(dpyH);
 
     ste2007_issue_compoundcmd(dpyH, STE2007_CMD_REFRESHRATE, 3, STE2007_MASK_REFRESHRATE); // Refresh rate = 65Hz
     ste2007_issue_compoundcmd(dpyH, STE2007_CMD_CHARGEPUMP, 0, STE2007_MASK_CHARGEPUMP); // Charge Pump multiply factor = 5x
-    ste2007_issuecmd(dpyH, STE2007_CMD_SETBIAS, 6, STE2007_MASK_SETBIAS); // Bias ratio = 1/4
-    ste2007_issue_compoundcmd(dpyH, STE2007_CMD_VOP, 0, STE2007_MASK_VOP);
+    ste2007_issuecmd(dpyH, STE2007_CMD_SETBIAS, NOKIA1202_INIT_BIAS, STE2007_MASK_SETBIAS);
+    ste2007_issue_compoundcmd(dpyH, STE2007_CMD_VOP, NOKIA1202_INIT_VOP, STE2007_MASK_VOP);
     ste2007_issuecmd(dpyH, STE2007_CMD_DPYREV, 0, STE2007_MASK_DPYREV); // Display normal (not inverted)
 
+    // Shadow registers now reflect what was just programmed
+    o->contrast = 16;
+    o->invert = 0;
+    o->powersave = 0;
+    o->refreshrate = 65;
+    o->backlight = 0;
+
     o->lineClearMode = params->lineClearMode;
 
     // Release mutex
@@ -206,72 +467,125 @@ Display_Handle ste2007_open(Display_Handle dpyH, Display_Params *params)
 //! @brief Fully erase DDRAM - TI Display_clear() handler
 void ste2007_clear(Display_Handle dpyH)
 {
-    int i;
-    DisplayNokia1202_Object *o = dpyH->object;
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+    ste2007_clear_nolock(dpyH);
+    ste2007_unlock(dpyH);
+}
 
-    SemaphoreP_pend(o->mutex, SemaphoreP_WAIT_FOREVER);
+//! @brief Fully erase DDRAM, waiting at most <timeout> ticks for the display
+//! @return DISPLAY_STATUS_SUCCESS, NOKIA1202_STATUS_BUSY or NOKIA1202_STATUS_TIMEOUT
+int ste2007_clear_timeout(Display_Handle dpyH, uint32_t timeout)
+{
+    int ret = ste2007_lock(dpyH, timeout);
 
-    for(i=0; i < 16*6; i++) {
-        o->_rowBuf[i] = 0x0100;
+    if (ret != DISPLAY_STATUS_SUCCESS) {
+        return ret;
     }
-    o->rowbuffer.len = 16*6;
+    ste2007_clear_nolock(dpyH);
+    return ste2007_unlock(dpyH);
+}
+
+//! @brief Fully erase DDRAM; caller holds the mutex
+static void ste2007_clear_nolock(Display_Handle dpyH)
+{
+    ste2007_clearspan_nolock(dpyH, 0, 0, STE2007_PAGES * STE2007_COLUMNS);
+}
 
+/**
+ * @brief Blank <len> DDRAM columns starting at column <x> of <line>, continuing onto the following lines
+ * @details All of it goes out under one chip select, since the column auto-wrap carries on to the start of the next
+ *          line, in transfers of up to one row from ste2007_zerorow.  Caller holds the mutex.
+ */
+static void ste2007_clearspan_nolock(Display_Handle dpyH, uint8_t x, uint8_t line, uint32_t len)
+{
     SPI_Transaction txn;
-    txn.count = o->rowbuffer.len;
-    txn.txBuf = (void *)(o->rowbuffer.buf);
-    txn.rxBuf = (void *)0;
+    uint32_t max;
+
+    if (x >= STE2007_COLUMNS || line >= STE2007_PAGES || len == 0) {
+        return;
+    }
+    max = (uint32_t)(STE2007_PAGES - line) * STE2007_COLUMNS - x;
+    if (len > max) {
+        len = max;
+    }
 
-    ste2007_setxy(dpyH, 0, 0);
+    ste2007_setxy(dpyH, x, line);
     ste2007_chipselect(dpyH, 0);
-    for (i=0; i < 9; i++) {  // Each SPI_transfer writes 1 full row, do this 9 times.
-        SPI_transfer(o->bus, &txn);
+    txn.txBuf = (void *)ste2007_zerorow;
+    txn.rxBuf = (void *)0;
+    while (len > 0) {
+        txn.count = (len > STE2007_COLUMNS) ? STE2007_COLUMNS : len;
+        ste2007_spitransfer(dpyH, &txn);
+        ste2007_advancecursor(dpyH, txn.count);
+        len -= txn.count;
     }
     ste2007_chipselect(dpyH, 1);
-
-    SemaphoreP_post(o->mutex);
 }
 
 //! @brief Erase a single line - TI Display_clearLines() handler
 void ste2007_clearLines(Display_Handle dpyH, uint8_t start, uint8_t end)
 {
-    int i;
-    DisplayNokia1202_Object *o = dpyH->object;
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+    ste2007_clearLines_nolock(dpyH, start, end);
+    ste2007_unlock(dpyH);
+}
 
-    SemaphoreP_pend(o->mutex, SemaphoreP_WAIT_FOREVER);
+//! @brief Erase lines <start> through <end>, waiting at most <timeout> ticks for the display
+//! @return DISPLAY_STATUS_SUCCESS, NOKIA1202_STATUS_BUSY or NOKIA1202_STATUS_TIMEOUT
+int ste2007_clearLines_timeout(Display_Handle dpyH, uint32_t timeout, uint8_t start, uint8_t end)
+{
+    int ret = ste2007_lock(dpyH, timeout);
 
-    for(i=0; i < 16*6; i++) {
-        o->_rowBuf[i] = 0x0100;
+    if (ret != DISPLAY_STATUS_SUCCESS) {
+        return ret;
     }
-    o->rowbuffer.len = 16*6;
-
-    SPI_Transaction txn;
-    txn.count = o->rowbuffer.len;
-    txn.txBuf = (void *)(o->rowbuffer.buf);
-    txn.rxBuf = (void *)0;
+    ste2007_clearLines_nolock(dpyH, start, end);
+    return ste2007_unlock(dpyH);
+}
 
+//! @brief Erase lines <start> through <end>; caller holds the mutex
+static void ste2007_clearLines_nolock(Display_Handle dpyH, uint8_t start, uint8_t end)
+{
     if (end < start) {
         // Somewhat undefined behavior in the docs, but, the DisplaySharp library uses this logic.
         // The Display_clearLine() macro depends on using Display_doClearLines(handle, start, 0) to erase a single line.
         end = start;
     }
 
-    for (i=start; i <= end; i++) {
-        ste2007_setxy(dpyH, 0, i);
-        ste2007_chipselect(dpyH, 0);
-        SPI_transfer(o->bus, &txn);
-        ste2007_chipselect(dpyH, 1);
-    }
-
-    SemaphoreP_post(o->mutex);
+    ste2007_clearspan_nolock(dpyH, 0, start, (uint32_t)(end - start + 1) * STE2007_COLUMNS);
 }
 
 
 //! @brief Set DDRAM cursor
+//! @details Only the parts of the address (page, column MSB, column LSB) that differ from the shadowed cursor are sent.
 void ste2007_setxy(Display_Handle dpyH, uint8_t x, uint8_t y)
 {
-    ste2007_issuecmd(dpyH, STE2007_CMD_LINE, y, STE2007_MASK_LINE);
-    ste2007_issuecmd(dpyH, STE2007_CMD_COLMSB, x >> 4, STE2007_MASK_COLMSB);
-    ste2007_issuecmd(dpyH, STE2007_CMD_COLLSB, x, STE2007_MASK_COLLSB);
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    x &= (STE2007_MASK_COLMSB << 4) | STE2007_MASK_COLLSB;
+    y &= STE2007_MASK_LINE;
+
+    if (o->frameOpen) {
+        // Nothing reaches DDRAM until the frame is committed, so only the shadow's notion of the cursor moves
+        o->curX = x;
+        o->curY = y;
+        return;
+    }
+    if (o->curY != y) {
+        ste2007_issuecmd(dpyH, STE2007_CMD_LINE, y, STE2007_MASK_LINE);
+    }
+    if (o->curX == STE2007_SHADOW_UNKNOWN || (o->curX >> 4) != (x >> 4)) {
+        ste2007_issuecmd(dpyH, STE2007_CMD_COLMSB, x >> 4, STE2007_MASK_COLMSB);
+    }
+    if (o->curX == STE2007_SHADOW_UNKNOWN || (o->curX & 0x0F) != (x & 0x0F)) {
+        ste2007_issuecmd(dpyH, STE2007_CMD_COLLSB, x, STE2007_MASK_COLLSB);
+    }
+    o->curX = x;
+    o->curY = y;
 }
 
 //! @brief Bulk-write data to DDRAM
@@ -291,23 +605,172 @@ void ste2007_write(Display_Handle dpyH, const void *buf, uint16_t len)
         txn.txBuf = (void *)(o->rowbuffer.buf);
         txn.rxBuf = (void *)0;
 
-        SPI_transfer(o->bus, &txn);
+        ste2007_spitransfer(dpyH, &txn);
+        ste2007_advancecursor(dpyH, txn.count);
 
         ttl += o->rowbuffer.len;
     }
 }
 
+//! @brief Write <len> copies of the same DDRAM byte at the current cursor
+//! @details Like ste2007_write, the caller drives Chip Select.
+void ste2007_writefill(Display_Handle dpyH, uint8_t pattern, uint16_t len)
+{
+    uint32_t ttl = 0, i;
+    DisplayNokia1202_Object *o = dpyH->object;
+    SPI_Transaction txn;
+
+    for (i=0; i < o->rowbuffer.cap && i < len; i++) {
+        o->rowbuffer.buf[i] = 0x0100 | pattern;
+    }
+    o->rowbuffer.len = i;
+
+    while (ttl < len) {
+        txn.count = ((len - ttl) > o->rowbuffer.len ? o->rowbuffer.len : len - ttl);
+        txn.txBuf = (void *)(o->rowbuffer.buf);
+        txn.rxBuf = (void *)0;
+
+        ste2007_spitransfer(dpyH, &txn);
+        ste2007_advancecursor(dpyH, txn.count);
+
+        ttl += txn.count;
+    }
+}
+
+//! @brief Write a run of font_5x7 characters at the current DDRAM cursor
+//! @details Glyph columns are packed into the row buffer and sent in as few SPI transfers as possible (one per 16
+//!          characters).  Like ste2007_write, the caller drives Chip Select.
+void ste2007_writeglyphs(Display_Handle dpyH, const char *str, uint16_t len)
+{
+    uint16_t i;
+    unsigned int g;
+    DisplayNokia1202_Object *o = dpyH->object;
+    SPI_Transaction txn;
+
+    spitxn_reset(&(o->rowbuffer));
+    for (i=0; i < len; i++) {
+        g = (unsigned char)str[i];
+        if (g < 32 || g >= 32 + sizeof(font_5x7) / sizeof(font_5x7[0])) {
+            g = ' ';
+        }
+        if ((o->rowbuffer.cap - o->rowbuffer.len) < sizeof(font_5x7[0])) {
+            txn.count = o->rowbuffer.len;
+            txn.txBuf = (void *)(o->rowbuffer.buf);
+            txn.rxBuf = (void *)0;
+            ste2007_spitransfer(dpyH, &txn);
+            ste2007_advancecursor(dpyH, txn.count);
+            spitxn_reset(&(o->rowbuffer));
+        }
+        spitxn_push(&(o->rowbuffer), 0x01, (uint8_t *)font_5x7[g - 32], sizeof(font_5x7[0]));
+    }
+    if (o->rowbuffer.len > 0) {
+        txn.count = o->rowbuffer.len;
+        txn.txBuf = (void *)(o->rowbuffer.buf);
+        txn.rxBuf = (void *)0;
+        ste2007_spitransfer(dpyH, &txn);
+        ste2007_advancecursor(dpyH, txn.count);
+    }
+}
+
+//! @brief Start collecting runs of changed columns in <page>
+void ste2007_run_init(DisplayNokia1202_Run *run, Display_Handle dpyH, uint8_t page, DisplayNokia1202_RunFxn send, void *arg)
+{
+    run->dpyH = dpyH;
+    run->send = send;
+    run->arg = arg;
+    run->page = page;
+    run->start = -1;
+    run->end = -1;
+}
+
+//! @brief Add changed column <col>; the open run is sent first if the gap to it exceeds STE2007_MERGE_GAP
+void ste2007_run_add(DisplayNokia1202_Run *run, uint8_t col)
+{
+    if (run->start >= 0 && (col - run->end) > STE2007_MERGE_GAP + 1) {
+        run->send(run->dpyH, run->arg, run->page, run->start, run->end);
+        run->start = -1;
+    }
+    if (run->start < 0) {
+        run->start = col;
+    }
+    run->end = col;
+}
+
+//! @brief Send the open run, if any
+void ste2007_run_flush(DisplayNokia1202_Run *run)
+{
+    if (run->start >= 0) {
+        run->send(run->dpyH, run->arg, run->page, run->start, run->end);
+        run->start = -1;
+    }
+}
+
 //! @brief Set/unset the DisplayReverse feature
 void ste2007_invert(Display_Handle dpyH, uint8_t onoff)
 {
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    onoff &= STE2007_MASK_DPYREV;
+    if (o->invert == onoff) {
+        return;
+    }
     ste2007_issuecmd(dpyH, STE2007_CMD_DPYREV, onoff, STE2007_MASK_DPYREV);
+    o->invert = onoff;
 }
 
 //! @brief STE2007 datasheet lists ONOFF=0, DPYALLPTS=1 as a "Power saver" mode.
 void ste2007_powersave(Display_Handle dpyH, uint8_t onoff)  // 1 = power-saver mode, 0 = normal mode
 {
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    onoff &= STE2007_MASK_DPYALLPTS;
+    if (o->powersave == onoff) {
+        return;
+    }
     ste2007_issuecmd(dpyH, STE2007_CMD_DPYALLPTS, onoff, STE2007_MASK_DPYALLPTS);
     ste2007_issuecmd(dpyH, STE2007_CMD_ONOFF, !onoff, STE2007_MASK_ONOFF);
+    o->powersave = onoff;
+}
+
+/**
+ * @brief Set panel orientation using the controller's segment (column) and common (row) driver direction
+ * @details <flags> is a combination of NOKIA1202_ORIENT_MIRRORX and NOKIA1202_ORIENT_MIRRORY; both together give a
+ *          180 degree rotation.  This costs nothing at runtime since the STE2007 does the remapping itself, but DDRAM
+ *          contents already on the panel are flipped along with it, so redraw afterwards.
+ */
+void ste2007_orientation(Display_Handle dpyH, uint8_t flags)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    flags &= NOKIA1202_ORIENT_ROTATE180;
+    if (o->orientation == flags) {
+        return;
+    }
+    ste2007_issuecmd(dpyH, STE2007_CMD_COMDIR, (flags & NOKIA1202_ORIENT_MIRRORY) ? 0xFF : 0, STE2007_MASK_COMDIR);
+    ste2007_issuecmd(dpyH, STE2007_CMD_SEGMENTDIR, (flags & NOKIA1202_ORIENT_MIRRORX) ? 0xFF : 0, STE2007_MASK_SEGMENTDIR);
+    o->orientation = flags;
+}
+
+/**
+ * @brief Set the DDRAM row scanned out on the top line of the panel (0-63)
+ * @details The panel shows DDRAM rows 0-63 circularly from here on, which ste2007_canvas.c uses for hardware vertical
+ *          scrolling.  Everything else in the driver addresses DDRAM pages directly, so leave this at 0 otherwise.
+ *          Inside a frame the command is held back and sent by the commit after the frame's data.
+ */
+void ste2007_startline(Display_Handle dpyH, uint8_t line)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    line &= STE2007_MASK_DPYSTARTLINE;
+    if (o->frameOpen) {
+        o->frameStartline = line;  // Moving the scan before the frame's pages reach DDRAM would show them misplaced
+        return;
+    }
+    if (o->startline == line) {
+        return;
+    }
+    ste2007_issuecmd(dpyH, STE2007_CMD_DPYSTARTLINE, line, STE2007_MASK_DPYSTARTLINE);
+    o->startline = line;
 }
 
 /**
@@ -317,13 +780,30 @@ void ste2007_powersave(Display_Handle dpyH, uint8_t onoff)  // 1 = power-saver m
  */
 void ste2007_contrast(Display_Handle dpyH, uint8_t val)
 {
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    val &= STE2007_MASK_ELECTVOL;
+    if (o->contrast == val) {
+        return;
+    }
     ste2007_issuecmd(dpyH, STE2007_CMD_ELECTVOL, val, STE2007_MASK_ELECTVOL);
+    o->contrast = val;
 }
 
 //! @brief Set LCD refresh rate
 //! @details Supported values: 65, 70, 75, 80 (Hz)
 void ste2007_refreshrate(Display_Handle dpyH, uint8_t val)
 {
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    if (val != 80 && val != 75 && val != 70) {
+        val = 65;
+    }
+    if (o->refreshrate == val) {
+        return;
+    }
+    o->refreshrate = val;
+
     switch (val) {
         case 80:
             ste2007_issue_compoundcmd(dpyH, STE2007_CMD_REFRESHRATE, 0, STE2007_MASK_REFRESHRATE);
@@ -340,41 +820,52 @@ void ste2007_refreshrate(Display_Handle dpyH, uint8_t val)
         default:
             ste2007_issue_compoundcmd(dpyH, STE2007_CMD_REFRESHRATE, 3, STE2007_MASK_REFRESHRATE);
     }
+    ste2007_gray_retime(dpyH);  // Grayscale phases are paced off the refresh rate
 }
 
 
 //! @brief vprintf for TI Display printf API
 void ste2007_vprintf(Display_Handle dpyH, uint8_t line, uint8_t col, char *fmt, va_list va)
 {
-    int i;
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+    ste2007_vprintf_nolock(dpyH, line, col, fmt, va);
+    ste2007_unlock(dpyH);
+}
+
+//! @brief Display_printf() equivalent which waits at most <timeout> ticks for the display
+//! @return DISPLAY_STATUS_SUCCESS, NOKIA1202_STATUS_BUSY or NOKIA1202_STATUS_TIMEOUT
+int ste2007_printf_timeout(Display_Handle dpyH, uint32_t timeout, uint8_t line, uint8_t col, const char *fmt, ...)
+{
+    va_list va;
+    int ret = ste2007_lock(dpyH, timeout);
+
+    if (ret != DISPLAY_STATUS_SUCCESS) {
+        return ret;
+    }
+    va_start(va, fmt);
+    ste2007_vprintf_nolock(dpyH, line, col, fmt, va);
+    va_end(va);
+    return ste2007_unlock(dpyH);
+}
+
+//! @brief vprintf worker; caller holds the mutex
+static void ste2007_vprintf_nolock(Display_Handle dpyH, uint8_t line, uint8_t col, const char *fmt, va_list va)
+{
     char dispStr[32], *c;
     DisplayNokia1202_Object *o = dpyH->object;
 
-    SemaphoreP_pend(o->mutex, SemaphoreP_WAIT_FOREVER);
-
-    // Act upon lineClearMode first (so we can use dispStr for an alternate purpose before applying vsnprintf)
+    // Act upon lineClearMode first; <col> is a pixel column
     if (o->lineClearMode != DISPLAY_CLEAR_NONE) {
         if (o->lineClearMode == DISPLAY_CLEAR_LEFT) {
-            for(i=0; i < col; i++) {
-                dispStr[i] = '\0';
-            }
-            ste2007_setxy(dpyH, 0, line);
-            ste2007_chipselect(dpyH, 0);
-            ste2007_write(dpyH, dispStr, col);
-            ste2007_chipselect(dpyH, 1);
+            ste2007_clearspan_nolock(dpyH, 0, line, (col < STE2007_COLUMNS) ? col : STE2007_COLUMNS);
         } else if (o->lineClearMode == DISPLAY_CLEAR_RIGHT) {
-            for (i=0; i < (16-col); i++) {
-                dispStr[i] = '\0';
+            if (col < STE2007_COLUMNS) {
+                ste2007_clearspan_nolock(dpyH, col, line, STE2007_COLUMNS - col);
             }
-            ste2007_setxy(dpyH, col, line);
-            ste2007_chipselect(dpyH, 0);
-            ste2007_write(dpyH, dispStr, 16-col);
-            ste2007_chipselect(dpyH, 1);
         } else if (o->lineClearMode == DISPLAY_CLEAR_BOTH) {
-            // Need to release the mutex because ste2007_clearLines() uses it
-            SemaphoreP_post(o->mutex);
-            ste2007_clearLines(dpyH, line, line);
-            SemaphoreP_pend(o->mutex, SemaphoreP_WAIT_FOREVER);
+            ste2007_clearLines_nolock(dpyH, line, line);
         }
     }
 
@@ -383,15 +874,405 @@ void ste2007_vprintf(Display_Handle dpyH, uint8_t line, uint8_t col, char *fmt,
     // Write out dispStr
     ste2007_setxy(dpyH, col, line);
     c = &dispStr[0];
+    while (*c) {  // Find the end so the whole string goes out as one batch of glyphs
+        c++;
+    }
 
     ste2007_chipselect(dpyH, 0);
-    while (*c) {
-        ste2007_write(dpyH, font_5x7[(unsigned int)*c - 32], 6);
-        c++;
+    ste2007_writeglyphs(dpyH, dispStr, c - dispStr);
+    ste2007_chipselect(dpyH, 1);
+}
+
+
+/** @brief Magnified text
+ *  @details A font_5x7 column byte magnified n times vertically is n bytes tall.  The bit spreading is done a nibble
+ *           at a time through the tables below, so each output page costs 2 lookups and a shift per column.
+ */
+
+//! @brief Nibble to byte with every bit doubled (bit k -> bits 2k, 2k+1)
+static const uint8_t ste2007_scale2[16] = {
+    0x00, 0x03, 0x0C, 0x0F, 0x30, 0x33, 0x3C, 0x3F, 0xC0, 0xC3, 0xCC, 0xCF, 0xF0, 0xF3, 0xFC, 0xFF
+};
+
+//! @brief Nibble to 12 bits with every bit tripled (bit k -> bits 3k .. 3k+2)
+static const uint16_t ste2007_scale3[16] = {
+    0x000, 0x007, 0x038, 0x03F, 0x1C0, 0x1C7, 0x1F8, 0x1FF, 0xE00, 0xE07, 0xE38, 0xE3F, 0xFC0, 0xFC7, 0xFF8, 0xFFF
+};
+
+//! @brief Page <page> of font_5x7 column byte <b> magnified <scale> times vertically
+static uint8_t ste2007_scale_column(uint8_t b, uint8_t scale, uint8_t page)
+{
+    switch (scale) {
+        case 2:
+            return ste2007_scale2[(page == 0) ? (b & 0x0F) : (b >> 4)];
+        case 3:
+            return (uint8_t)((ste2007_scale3[b & 0x0F] | ((uint32_t)ste2007_scale3[b >> 4] << 12)) >> (page * 8));
+        default:
+            return b;
     }
+}
+
+/**
+ * @brief printf() font_5x7 text magnified <scale> times, with its top-left corner at pixel column <col> of <line>
+ * @details <scale> is clamped to 1..NOKIA1202_SCALE_MAX; each character is 6*<scale> columns wide and <scale> lines
+ *          tall.  Text is clipped at the right edge of the panel and at line 8, and nothing is drawn if <col> is past
+ *          the last column.  dispStr holds one unscaled line (17 bytes), so only the first 16 characters of the
+ *          formatted text are used.
+ */
+void ste2007_printscaled(Display_Handle dpyH, uint8_t line, uint8_t col, uint8_t scale, const char *fmt, ...)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    SPI_Transaction txn;
+    va_list va;
+    char dispStr[STE2007_COLUMNS / sizeof(font_5x7[0]) + 1];
+    const uint8_t *glyph;
+    unsigned int g;
+    uint16_t n, i, j, k;
+    uint8_t page, b;
+
+    if (scale < 1) {
+        scale = 1;
+    } else if (scale > NOKIA1202_SCALE_MAX) {
+        scale = NOKIA1202_SCALE_MAX;
+    }
+    if (col >= STE2007_COLUMNS) {
+        return;
+    }
+
+    va_start(va, fmt);
+    SystemP_vsnprintf(dispStr, sizeof(dispStr), fmt, va);
+    va_end(va);
+
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+
+    for (page=0; page < scale && line + page < STE2007_PAGES; page++) {
+        // A full line is exactly one rowbuffer, so each page is built up whole and sent in one go
+        n = 0;
+        for (i=0; dispStr[i] && n < STE2007_COLUMNS - col; i++) {
+            g = (unsigned char)dispStr[i];
+            if (g < 32 || g >= 32 + sizeof(font_5x7) / sizeof(font_5x7[0])) {
+                g = ' ';
+            }
+            glyph = font_5x7[g - 32];
+            for (j=0; j < sizeof(font_5x7[0]) && n < STE2007_COLUMNS - col; j++) {
+                b = ste2007_scale_column(glyph[j], scale, page);
+                for (k=0; k < scale && n < STE2007_COLUMNS - col; k++) {
+                    o->rowbuffer.buf[n++] = 0x0100 | b;
+                }
+            }
+        }
+        if (n == 0) {
+            break;
+        }
+        o->rowbuffer.len = n;
+
+        ste2007_setxy(dpyH, col, line + page);
+        ste2007_chipselect(dpyH, 0);
+        txn.count = n;
+        txn.txBuf = (void *)(o->rowbuffer.buf);
+        txn.rxBuf = (void *)0;
+        ste2007_spitransfer(dpyH, &txn);
+        ste2007_advancecursor(dpyH, txn.count);
+        ste2007_chipselect(dpyH, 1);
+    }
+
+    ste2007_unlock(dpyH);
+}
+
+
+/** @brief Numeric readouts
+ *  @details These bypass SystemP_vsnprintf entirely: digits are produced right-aligned straight into the field's
+ *           character cells, compared with what the field last put on the panel, and only the changed span of
+ *           glyphs is sent.
+ */
+
+/**
+ * @brief Set up a numeric readout field at pixel column <col> of <line>, <width> characters wide
+ * @details Also use this to force a full redraw of the field, e.g. after the line has been cleared.  <width> is cut
+ *          down to what fits before the right edge of the panel.
+ * @return false if <line> or <col> leaves no room for a single character; the field is then left empty (width 0)
+ *         and updates to it draw nothing
+ */
+bool ste2007_numfield_init(DisplayNokia1202_NumField *f, uint8_t line, uint8_t col, uint8_t width, char pad)
+{
+    uint8_t i;
+    bool ok = true;
+
+    if (line >= STE2007_PAGES || col > STE2007_COLUMNS - 6) {
+        line = 0;
+        col = 0;
+        width = 0;
+        ok = false;
+    }
+    if (width > (STE2007_COLUMNS - col) / 6) {
+        width = (STE2007_COLUMNS - col) / 6;  // Never wrap onto the next page through the column auto-increment
+    }
+    f->line = line;
+    f->col = col;
+    f->width = width;
+    f->pad = pad;
+    for (i=0; i < NOKIA1202_NUMFIELD_MAXWIDTH; i++) {
+        f->shown[i] = '\0';  // Never matches a rendered character, so the first update draws everything
+    }
+    return ok;
+}
+
+//! @brief Send the cells of <cells> that differ from what the field is currently showing
+static void ste2007_numfield_update(Display_Handle dpyH, DisplayNokia1202_NumField *f, const char *cells)
+{
+    int first, last, i;
+
+    for (first=0; first < f->width && cells[first] == f->shown[first]; first++)
+        ;
+    if (first == f->width) {
+        return;  // Nothing changed
+    }
+    for (last=f->width-1; cells[last] == f->shown[last]; last--)
+        ;
+
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;  // Field keeps its old contents and is retried on the next update
+    }
+
+    ste2007_setxy(dpyH, f->col + first * sizeof(font_5x7[0]), f->line);
+    ste2007_chipselect(dpyH, 0);
+    ste2007_writeglyphs(dpyH, &cells[first], last - first + 1);
     ste2007_chipselect(dpyH, 1);
 
-    SemaphoreP_post(o->mutex);
+    if (ste2007_unlock(dpyH) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+    for (i=first; i <= last; i++) {
+        f->shown[i] = cells[i];
+    }
+}
+
+/**
+ * @brief Render <mag> right-aligned into cells[0..pos), optionally followed by <decimals> fraction digits already
+ *        placed by the caller, then the sign and padding.
+ * @return false if the number does not fit in the field
+ */
+static bool ste2007_numfield_render(const DisplayNokia1202_NumField *f, char *cells, int pos, uint32_t mag, bool neg)
+{
+    do {
+        if (pos == 0) {
+            return false;
+        }
+        cells[--pos] = '0' + (mag % 10);
+        mag /= 10;
+    } while (mag);
+
+    if (neg) {
+        if (f->pad == '0') {
+            // Zero padding goes between the sign and the digits
+            while (pos > 1) {
+                cells[--pos] = '0';
+            }
+        }
+        if (pos == 0) {
+            return false;
+        }
+        cells[--pos] = '-';
+    }
+    while (pos > 0) {
+        cells[--pos] = f->pad;
+    }
+    return true;
+}
+
+//! @brief Fill the field with '#' to show that the value overflowed it
+static void ste2007_numfield_overflow(const DisplayNokia1202_NumField *f, char *cells)
+{
+    int i;
+
+    for (i=0; i < f->width; i++) {
+        cells[i] = '#';
+    }
+}
+
+//! @brief Print a signed integer right-aligned in a numeric field
+void ste2007_printint(Display_Handle dpyH, DisplayNokia1202_NumField *f, int32_t val)
+{
+    char cells[NOKIA1202_NUMFIELD_MAXWIDTH];
+    uint32_t mag = (val < 0) ? (uint32_t)0 - (uint32_t)val : (uint32_t)val;
+
+    if (!ste2007_numfield_render(f, cells, f->width, mag, val < 0)) {
+        ste2007_numfield_overflow(f, cells);
+    }
+    ste2007_numfield_update(dpyH, f, cells);
+}
+
+/**
+ * @brief Print a signed fixed-point value right-aligned in a numeric field
+ * @details <val> has <qbits> fractional bits (e.g. qbits=8 for Q23.8) and is rounded to <decimals> digits after the
+ *          decimal point.  qbits may be 0-31 and decimals 0-9.
+ */
+void ste2007_printfixed(Display_Handle dpyH, DisplayNokia1202_NumField *f, int32_t val, uint8_t qbits, uint8_t decimals)
+{
+    char cells[NOKIA1202_NUMFIELD_MAXWIDTH];
+    uint32_t mag = (val < 0) ? (uint32_t)0 - (uint32_t)val : (uint32_t)val;
+    uint32_t ipart, scale = 1;
+    uint64_t frac;
+    int pos, i;
+    bool neg;
+
+    if (qbits > 31) {
+        qbits = 31;
+    }
+    if (decimals > 9) {
+        decimals = 9;
+    }
+    for (i=0; i < decimals; i++) {
+        scale *= 10;
+    }
+
+    // Scale the fraction to <decimals> digits with round-half-up, carrying into the integer part
+    ipart = mag >> qbits;
+    frac = (uint64_t)(mag & ((1UL << qbits) - 1)) * scale;
+    if (qbits > 0) {
+        frac = (frac + (1ULL << (qbits - 1))) >> qbits;
+    }
+    if (frac >= scale) {
+        frac -= scale;
+        ipart++;
+    }
+
+    neg = (val < 0) && (ipart || frac);  // Don't show "-0.00" for values that round to zero
+
+    pos = f->width;
+    if (decimals > 0) {
+        if (pos < decimals + 2) {
+            ste2007_numfield_overflow(f, cells);
+            ste2007_numfield_update(dpyH, f, cells);
+            return;
+        }
+        for (i=0; i < decimals; i++) {
+            cells[--pos] = '0' + (frac % 10);
+            frac /= 10;
+        }
+        cells[--pos] = '.';
+    }
+
+    if (!ste2007_numfield_render(f, cells, pos, ipart, neg)) {
+        ste2007_numfield_overflow(f, cells);
+    }
+    ste2007_numfield_update(dpyH, f, cells);
+}
+
+
+/** @brief Frames
+ *  @details Between NOKIA1202_CMD_FRAMEBEGIN and NOKIA1202_CMD_FRAMECOMMIT every drawing call only updates the shadow
+ *           framebuffer, and each page remembers which columns' bytes changed.  The commit then sends just the runs of
+ *           changed columns (joined across gaps of up to STE2007_MERGE_GAP), in address order, under the single mutex
+ *           hold of its Display_control() call, followed by any start line set during the frame.  Other commands that
+ *           are not DDRAM data (contrast, invert...) still take effect immediately.
+ */
+
+//! @brief Mark every page clean
+void ste2007_frame_clean(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    uint8_t p, i;
+
+    for (p=0; p < STE2007_PAGES; p++) {
+        o->dirtyLo[p] = STE2007_COLUMNS;
+        o->dirtyHi[p] = 0;
+        for (i=0; i < STE2007_COLUMNS / 8; i++) {
+            o->dirtyCols[p][i] = 0;
+        }
+    }
+    o->frameStartline = STE2007_SHADOW_UNKNOWN;
+}
+
+//! @brief Mark columns <lo>..<hi> of page <p> dirty
+static void ste2007_frame_mark(DisplayNokia1202_Object *o, uint8_t p, uint8_t lo, uint8_t hi)
+{
+    uint8_t c;
+
+    for (c=lo; c <= hi; c++) {
+        o->dirtyCols[p][c >> 3] |= 1 << (c & 7);
+    }
+    if (lo < o->dirtyLo[p]) {
+        o->dirtyLo[p] = lo;
+    }
+    if (hi > o->dirtyHi[p]) {
+        o->dirtyHi[p] = hi;
+    }
+}
+
+//! @brief Run callback for ste2007_frame_commit(): send shadow columns <lo>..<hi> of page <p>
+//! @details <arg> is the commit's chip select state, kept asserted while the cursor already sits where the run starts.
+static void ste2007_frame_send(Display_Handle dpyH, void *arg, uint8_t p, uint8_t lo, uint8_t hi)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    bool *selected = (bool *)arg;
+    SPI_Transaction txn;
+
+    if (o->curX != lo || o->curY != p) {
+        if (*selected) {
+            ste2007_chipselect(dpyH, 1);
+            *selected = false;
+        }
+        ste2007_setxy(dpyH, lo, p);
+    }
+    if (!*selected) {
+        ste2007_chipselect(dpyH, 0);
+        *selected = true;
+    }
+    spitxn_reset(&(o->rowbuffer));
+    spitxn_push(&(o->rowbuffer), 0x01, &o->shadow[p * STE2007_COLUMNS + lo], hi - lo + 1);
+    txn.count = o->rowbuffer.len;
+    txn.txBuf = (void *)(o->rowbuffer.buf);
+    txn.rxBuf = (void *)0;
+    ste2007_spitransfer(dpyH, &txn);
+    ste2007_advancecursor(dpyH, txn.count);
+}
+
+//! @brief Send the frame's changed runs and leave frame mode; caller holds the mutex
+static int ste2007_frame_commit(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    DisplayNokia1202_Run run;
+    uint8_t p, c;
+    bool selected = false;
+
+    o->frameOpen = false;
+    // setxy() did not move the chip's cursor during the frame
+    o->curX = STE2007_SHADOW_UNKNOWN;
+    o->curY = STE2007_SHADOW_UNKNOWN;
+
+    // Let spans flow across page boundaries through the column auto-wrap where the unchanged gap is cheaper to resend
+    for (p=0; p+1 < STE2007_PAGES; p++) {
+        if (o->dirtyLo[p] <= o->dirtyHi[p] && o->dirtyLo[p+1] <= o->dirtyHi[p+1] &&
+            (STE2007_COLUMNS - 1 - o->dirtyHi[p]) + o->dirtyLo[p+1] <= STE2007_MERGE_GAP) {
+            ste2007_frame_mark(o, p, o->dirtyHi[p], STE2007_COLUMNS - 1);
+            ste2007_frame_mark(o, p+1, 0, o->dirtyLo[p+1]);
+        }
+    }
+
+    for (p=0; p < STE2007_PAGES; p++) {
+        if (o->dirtyLo[p] > o->dirtyHi[p]) {
+            continue;
+        }
+        ste2007_run_init(&run, dpyH, p, ste2007_frame_send, &selected);
+        for (c=o->dirtyLo[p]; c <= o->dirtyHi[p]; c++) {
+            if (o->dirtyCols[p][c >> 3] & (1 << (c & 7))) {
+                ste2007_run_add(&run, c);
+            }
+        }
+        ste2007_run_flush(&run);
+    }
+    if (selected) {
+        ste2007_chipselect(dpyH, 1);
+    }
+    if (o->frameStartline != STE2007_SHADOW_UNKNOWN) {
+        ste2007_startline(dpyH, o->frameStartline);
+    }
+    ste2007_frame_clean(dpyH);
+
+    return o->txnFailed ? NOKIA1202_STATUS_TIMEOUT : DISPLAY_STATUS_SUCCESS;
 }
 
 
@@ -405,14 +1286,23 @@ unsigned int ste2007_getType()
 //! @brief Wrapper to avoid littering ste2007_control() with Semaphore_post's at every return
 int ste2007_control_mutexwrapped(Display_Handle dpyH, unsigned int cmd, void *arg)
 {
-    DisplayNokia1202_Object *o = dpyH->object;
-    int ret;
+    return ste2007_control_timeout(dpyH, NOKIA1202_TIMEOUT_DEFAULT, cmd, arg);
+}
 
-    SemaphoreP_pend(o->mutex, SemaphoreP_WAIT_FOREVER);
+//! @brief Display_control() equivalent which waits at most <timeout> ticks for the display
+//! @return As ste2007_control(), or NOKIA1202_STATUS_BUSY / NOKIA1202_STATUS_TIMEOUT
+int ste2007_control_timeout(Display_Handle dpyH, uint32_t timeout, unsigned int cmd, void *arg)
+{
+    int ret, status;
+
+    ret = ste2007_lock(dpyH, timeout);
+    if (ret != DISPLAY_STATUS_SUCCESS) {
+        return ret;
+    }
     ret = ste2007_control(dpyH, cmd, arg);
-    SemaphoreP_post(o->mutex);
+    status = ste2007_unlock(dpyH);
 
-    return ret;
+    return (status != DISPLAY_STATUS_SUCCESS) ? status : ret;
 }
 
 //! @brief Custom control of the display - Display_control() handler
@@ -421,11 +1311,11 @@ int ste2007_control_mutexwrapped(Display_Handle dpyH, unsigned int cmd, void *ar
 int ste2007_control(Display_Handle dpyH, unsigned int cmd, void *arg)
 {
     uint8_t *u8ptr;
+    DisplayNokia1202_Object *o = dpyH->object;
     const DisplayNokia1202_HWAttrsV1 *h = dpyH->hwAttrs;
 
     /* Note: The display's mutex is in a pended state when this function runs, so if we need to run
-     * any mutex-dependent functions e.g. ste2007_clear(), we should grab the dpyH->object->mutex and post, followed
-     * by a pend after the mutex-dependent function completes.
+     * any mutex-dependent functions e.g. ste2007_clear(), use their *_nolock worker instead.
      */
 
     switch (cmd) {
@@ -486,12 +1376,68 @@ int ste2007_control(Display_Handle dpyH, unsigned int cmd, void *arg)
             if (!h->useBacklight) {
                 return DISPLAY_STATUS_SUCCESS;  // Nothing to do here so just pretend all's good
             }
+            if (o->backlight == !!(*u8ptr)) {
+                return DISPLAY_STATUS_SUCCESS;
+            }
             if (*u8ptr) {
                 GPIO_write(h->backlightPin, 1);
             } else {
                 GPIO_write(h->backlightPin, 0);
             }
+            o->backlight = !!(*u8ptr);
             return DISPLAY_STATUS_SUCCESS;
+
+        case NOKIA1202_CMD_ORIENTATION:
+            if (arg == (void *)0) {
+                return DISPLAY_STATUS_ERROR;
+            }
+            u8ptr = (uint8_t *)arg;
+            if (*u8ptr & ~NOKIA1202_ORIENT_ROTATE180) {
+                return NOKIA1202_ORIENTATION_INVALID;
+            }
+            ste2007_orientation(dpyH, *u8ptr);
+            return DISPLAY_STATUS_SUCCESS;
+
+        case NOKIA1202_CMD_GRAYSCALE:
+            // arg may be NULL here; that detaches the grayscale region
+            return ste2007_gray_attach(dpyH, (DisplayNokia1202_Gray *)arg);
+
+        case NOKIA1202_CMD_GRAYBUDGET:
+            if (arg == (void *)0) {
+                return DISPLAY_STATUS_ERROR;
+            }
+            return ste2007_gray_budget(dpyH, (DisplayNokia1202_GrayBudget *)arg);
+
+        case NOKIA1202_CMD_FRAMEBEGIN:
+            if (o->shadow == NULL || o->frameOpen) {
+                return NOKIA1202_FRAME_INVALID;
+            }
+            ste2007_frame_clean(dpyH);
+            o->frameOpen = true;
+            return DISPLAY_STATUS_SUCCESS;
+
+        case NOKIA1202_CMD_FRAMECOMMIT:
+            if (!o->frameOpen) {
+                return NOKIA1202_FRAME_INVALID;
+            }
+            return ste2007_frame_commit(dpyH);
+
+        case NOKIA1202_CMD_SCRUBRATE:
+            if (arg == (void *)0) {
+                return DISPLAY_STATUS_ERROR;
+            }
+            if (o->shadow == NULL || *(uint16_t *)arg > 1000) {
+                return NOKIA1202_SCRUBRATE_INVALID;
+            }
+            o->scrubPermille = *(uint16_t *)arg;
+            return DISPLAY_STATUS_SUCCESS;
+
+#ifdef NOKIA1202_TRACE
+        case NOKIA1202_CMD_TRACE:
+            // arg may be NULL here; that detaches the trace buffer
+            o->trace = (DisplayNokia1202_Trace *)arg;
+            return DISPLAY_STATUS_SUCCESS;
+#endif
     }
 
     return DISPLAY_STATUS_UNDEFINEDCMD;  // Command not found
@@ -504,9 +1450,20 @@ void ste2007_close(Display_Handle dpyH)
 
     SemaphoreP_pend(o->mutex, SemaphoreP_WAIT_FOREVER);
 
+    ste2007_gray_attach(dpyH, NULL);
+    if (o->graySem != NULL) {
+        SemaphoreP_delete(o->graySem);  // The detach above has already woken a task blocked in ste2007_gray_service()
+        o->graySem = NULL;
+    }
+    o->shadow = NULL;
+    o->scrubPermille = 0;
+    o->frameOpen = false;
+    ste2007_frame_clean(dpyH);
     ste2007_chipselect(dpyH, 1);
     SPI_close(o->bus);
     o->bus = NULL;
+    o->txnFailed = false;
+    ste2007_invalidate(dpyH);
 
     SemaphoreP_post(o->mutex);
 }
@@ -27,9 +27,11 @@
 
 
 #include <stdint.h>
+#include <stdarg.h>
 #include <ti/display/Display.h>
 #include <ti/drivers/SPI.h>
 #include <ti/drivers/dpl/SemaphoreP.h>
+#include <ti/drivers/dpl/ClockP.h>
 #include "spitxn.h"
 
 /* These commands are standard CMD | DATA operations.
@@ -115,6 +117,23 @@
 #define STE2007_CMD_ICONMODE 0xF8
 #define STE2007_MASK_ICONMODE 0x01
 
+// Panel geometry: 96 columns x 68 rows, addressed as 9 pages of 8 rows (the last page is only half visible)
+#define STE2007_COLUMNS 96
+#define STE2007_PAGES 9
+
+// SPI clock used for the panel
+#define NOKIA1202_SPI_BITRATE 1000000
+
+// Analog settings programmed by ste2007_open() and restored by ste2007_scrub()
+#define NOKIA1202_INIT_VOP 0
+#define NOKIA1202_INIT_BIAS 6  // Bias ratio = 1/4
+
+// Marks a shadow register whose value on the chip is not known (after init, soft reset or close)
+#define STE2007_SHADOW_UNKNOWN 0xFF
+
+// A cursor move costs up to 3 command words, so unchanged gaps this short are cheaper to resend than to skip over
+#define STE2007_MERGE_GAP 3
+
 
 /**
  * @brief Library functions for the STE2007 driver
@@ -131,26 +150,152 @@ void ste2007_clear(Display_Handle);
 void ste2007_clearLines(Display_Handle, uint8_t start, uint8_t end);
 void ste2007_setxy(Display_Handle, uint8_t x, uint8_t y);
 void ste2007_write(Display_Handle, const void *buf, uint16_t len);
+void ste2007_writefill(Display_Handle, uint8_t pattern, uint16_t len);  // <len> copies of one DDRAM byte
+void ste2007_writeglyphs(Display_Handle, const char *str, uint16_t len);  // font_5x7 text at the current cursor
 void ste2007_invert(Display_Handle, uint8_t onoff);
 void ste2007_powersave(Display_Handle, uint8_t onoff);
 void ste2007_contrast(Display_Handle, uint8_t val);
 void ste2007_refreshrate(Display_Handle, uint8_t val);
+void ste2007_orientation(Display_Handle, uint8_t flags);
+void ste2007_startline(Display_Handle, uint8_t line);
+void ste2007_invalidate(Display_Handle);  // forget the shadowed controller state
+void ste2007_advancecursor(Display_Handle, uint32_t len);  // account for DDRAM column auto-increment
+void ste2007_spitransfer(Display_Handle, SPI_Transaction *txn);  // all bus traffic funnels through here
+int ste2007_lock(Display_Handle, uint32_t timeout);
+int ste2007_unlock(Display_Handle);
+
+/**
+ * @brief Runs of changed columns within one page
+ * @details Add the changed columns of a page in increasing order with ste2007_run_add(); columns no more than
+ *          STE2007_MERGE_GAP apart are joined into one run, and each finished run is handed to <send> as
+ *          (dpyH, arg, page, first column, last column).  ste2007_run_flush() sends the last one.  The caller holds
+ *          the mutex, and <send> does its own ste2007_setxy() and chip select.
+ */
+typedef void (*DisplayNokia1202_RunFxn)(Display_Handle, void *arg, uint8_t page, uint8_t start, uint8_t end);
+typedef struct {
+    Display_Handle dpyH;
+    DisplayNokia1202_RunFxn send;
+    void *arg;
+    uint8_t page;
+    int16_t start;  // -1 when no run is open
+    int16_t end;
+} DisplayNokia1202_Run;
+void ste2007_run_init(DisplayNokia1202_Run *run, Display_Handle, uint8_t page, DisplayNokia1202_RunFxn send, void *arg);
+void ste2007_run_add(DisplayNokia1202_Run *run, uint8_t col);
+void ste2007_run_flush(DisplayNokia1202_Run *run);
+
+/**
+ * @brief Bounded-latency variants of the Display_* API
+ * @details <timeout> is in ClockP ticks: 0 (SemaphoreP_NO_WAIT) is a try-lock, SemaphoreP_WAIT_FOREVER blocks and
+ *          NOKIA1202_TIMEOUT_DEFAULT uses DisplayNokia1202_HWAttrsV1.mutexTimeout.  They return DISPLAY_STATUS_SUCCESS,
+ *          NOKIA1202_STATUS_BUSY if the display was locked and timeout was 0, or NOKIA1202_STATUS_TIMEOUT if the wait
+ *          expired or an SPI transfer exceeded transferTimeout (the rest of that operation is then skipped).
+ *
+ *          Worst-case SPI bus time once the lock is held, at NOKIA1202_SPI_BITRATE = 1MHz (9us per word), not counting
+ *          the per-transfer driver overhead of the SPI implementation (measured with tools/ste2007_latency.c):
+ *          @n clear:        3 + 9*96 words = 867 words, 7.8ms
+ *          @n clearLines:   3 + 96 per line under one chip select, 867 words for all 9 lines, 7.8ms
+ *          @n printf:       3 + 96 (lineClearMode) + 3 + 31*6 (a full dispStr) = 288 words, 2.6ms (plus SystemP_vsnprintf)
+ *          @n control:      GRAYSCALE (attach or detach) and FRAMECOMMIT: 9 pages of up to 3 + 96 words = 891 words,
+ *                           8.0ms (882 measured); every other command at most 2 words, 18us
+ *          @n printscaled:  3 + 96 per magnified line, up to NOKIA1202_SCALE_MAX lines = 297 words, 2.7ms (291 measured)
+ *          @n drawbitmap:   3 + 96 per page, 891 words for all 9 pages, 8.0ms (867 measured for a full-panel bitmap)
+ *          @n drawtext:     3 + 96 per page the font is tall: 99 words, 0.9ms for ste2007_font5x7
+ *          @n printint/printfixed, bargraph_set, canvas_update: 3 + 96 = 99 words, 0.9ms
+ *          @n sparkline_push: 3 + 96 for the first draw, then 3 + length per changed run; 103 words measured, 0.9ms
+ *          @n canvas_show:  the clear figure + 1 start line word = 868 words, 7.8ms
+ *          @n canvas_pan:   9 pages of up to 3 + 96 words + 1 = 892 words, 8.0ms (870 measured)
+ *          @n canvas_hide:  1 word, then a clear under a second hold
+ *          The Display_* entry points themselves wait for mutexTimeout and silently skip the operation if it expires.
+ *          So do the drawing calls outside the Display_* API (ste2007_printscaled(), ste2007_drawbitmap(),
+ *          ste2007_drawtext(), the numeric fields, the widgets and the canvas), which have no _timeout variants and no
+ *          status: a skipped numeric field, bar graph or canvas pan is brought up to date by its next call, while a
+ *          skipped sparkline sample, text, bitmap or canvas update is simply lost.
+ */
+#define NOKIA1202_TIMEOUT_DEFAULT   0xFFFFFFFE
+int ste2007_printf_timeout(Display_Handle, uint32_t timeout, uint8_t line, uint8_t col, const char *fmt, ...);
+int ste2007_clear_timeout(Display_Handle, uint32_t timeout);
+int ste2007_clearLines_timeout(Display_Handle, uint32_t timeout, uint8_t start, uint8_t end);
+int ste2007_control_timeout(Display_Handle, uint32_t timeout, unsigned int cmd, void *arg);
 
 
 /* TI-RTOS struct definitions */
 
+/**
+ * @brief SPI trace capture ring, attached with Display_control(NOKIA1202_CMD_TRACE)
+ * @details Only recorded when the driver is built with NOKIA1202_TRACE defined.  Every chip select edge and every
+ *          SPI_transfer is appended to buf[] as a record of 16-bit words:
+ *          @n <type> <ticks bits 0-14> <ticks bits 15-29> [<count> <count 9-bit words...>]
+ *          @n <type> is one of NOKIA1202_TRACE_CS_ASSERT, NOKIA1202_TRACE_CS_RELEASE or NOKIA1202_TRACE_XFER (the latter
+ *          carries the count + words) and is the only word in the stream with bit 15 set.  Ticks are ClockP system ticks.
+ *          When the ring wraps, <wraps> is incremented and the oldest words are overwritten; dump buf[head..cap) followed by
+ *          buf[0..head) as little-endian words to get a chronological file for tools/ste2007_trace.c.
+ */
+typedef struct {
+    uint16_t *buf;
+    uint32_t cap;
+    uint32_t head;
+    uint32_t wraps;
+} DisplayNokia1202_Trace;
+
+#define NOKIA1202_TRACE_CS_ASSERT   0x8000
+#define NOKIA1202_TRACE_CS_RELEASE  0x8001
+#define NOKIA1202_TRACE_XFER        0x8002
+
+/**
+ * @brief Grayscale region for NOKIA1202_CMD_GRAYSCALE, see ste2007_gray.c
+ * @details planeHi/planeLo are <numPages> x <width> bytes each in column-byte page format (like DDRAM), and give each
+ *          pixel a level of 0 (clear) to 3 (black) as (hi << 1) | lo.  One modulation phase is sent every <divisor>
+ *          panel refreshes.  The struct and planes must stay valid while attached and the application should not draw
+ *          into the region by other means.
+ */
+typedef struct {
+    uint8_t firstPage;
+    uint8_t numPages;
+    uint8_t col;
+    uint8_t width;
+    uint8_t divisor;
+    const uint8_t *planeHi;
+    const uint8_t *planeLo;
+} DisplayNokia1202_Gray;
+
+//! @brief SPI load of the grayscale engine, filled in by NOKIA1202_CMD_GRAYBUDGET
+typedef struct {
+    uint8_t grayPages;          // Pages streamed every phase
+    uint32_t wordsPerPhase;     // 9-bit words sent per phase, including cursor moves
+    uint32_t phasesPerSecond;
+    uint32_t bitsPerSecond;
+    uint16_t busPermille;       // Share of the SPI bus (NOKIA1202_SPI_BITRATE) in 1/1000ths
+} DisplayNokia1202_GrayBudget;
+
 //! @brief HWAttrs struct definition for static runtime config of the display
 typedef struct {
     uint32_t spiBus;
     uint32_t csPin;
     uint32_t backlightPin;
     bool useBacklight;
+    uint8_t orientation;  // NOKIA1202_ORIENT_* flags applied at open; leave out (0) for the normal orientation
+    uint32_t mutexTimeout;  // ClockP ticks to wait for the display in the Display_* API; 0 = wait forever
+    uint32_t transferTimeout;  // SPI transferTimeout in ticks; 0 = wait forever
+    uint8_t *shadowBuf;  // NOKIA1202_SHADOW_SIZE bytes of RAM mirroring DDRAM for ste2007_scrub(), or NULL
+    uint16_t scrubPermille;  // Share of the SPI bus ste2007_scrub() may use, in 1/1000ths
 } DisplayNokia1202_HWAttrsV1;
 
+//! @brief Size of DisplayNokia1202_HWAttrsV1.shadowBuf - one byte per DDRAM column of every page
+#define NOKIA1202_SHADOW_SIZE       (STE2007_COLUMNS * STE2007_PAGES)
+
+//! @brief Orientation flags for DisplayNokia1202_HWAttrsV1.orientation and NOKIA1202_CMD_ORIENTATION
+#define NOKIA1202_ORIENT_NORMAL     0x00
+#define NOKIA1202_ORIENT_MIRRORX    0x01  // Reverse segment (column) direction
+#define NOKIA1202_ORIENT_MIRRORY    0x02  // Reverse common (row) direction
+#define NOKIA1202_ORIENT_ROTATE180  (NOKIA1202_ORIENT_MIRRORX | NOKIA1202_ORIENT_MIRRORY)
+
 /**
  * @brief Object struct definition holds the buffers and state; this should never be initialized by the user
  * @details The Nokia1202 driver is thread-safe using a semaphore as mutex but note individual operations directly
  *          write to the display; written data is not queued in a Mailbox first and handled by a secondary task.
+ *          The driver shadows the DDRAM cursor and the contrast/invert/powersave/refresh/backlight settings so that
+ *          commands which would not change anything on the chip are never sent.
  */
 typedef struct {
     SpiTxn_buffer cmdBuf;
@@ -160,8 +305,81 @@ typedef struct {
     SPI_Handle bus;
     Display_LineClearMode lineClearMode;
     SemaphoreP_Handle mutex;
+    bool txnFailed;  // An SPI transfer timed out during the current operation
+    // Shadow registers - last value sent to the STE2007, or STE2007_SHADOW_UNKNOWN
+    uint8_t curX;
+    uint8_t curY;
+    uint8_t contrast;
+    uint8_t orientation;
+    uint8_t startline;
+    uint8_t invert;
+    uint8_t powersave;
+    uint8_t refreshrate;
+    uint8_t backlight;
+    // Grayscale engine
+    DisplayNokia1202_Gray *gray;
+    uint16_t grayPages;
+    uint8_t grayPhase;
+    ClockP_Handle grayClock;
+    SemaphoreP_Handle graySem;
+    // DDRAM scrubber
+    uint8_t *shadow;  // Copy of every DDRAM byte written, NULL when no shadowBuf was supplied
+    uint16_t shadowStale;  // Pages (bit n = page n) the panel may not match the shadow on, until rewritten in full
+    uint8_t scrubPage;
+    uint16_t scrubPermille;
+    uint32_t scrubCredit;  // Token bucket, in microseconds of bus time x permille
+    uint32_t scrubTick;
+    // Frame in progress (NOKIA1202_CMD_FRAMEBEGIN) - changed columns per page; clean when lo > hi
+    bool frameOpen;
+    uint8_t dirtyLo[STE2007_PAGES];
+    uint8_t dirtyHi[STE2007_PAGES];
+    uint8_t dirtyCols[STE2007_PAGES][STE2007_COLUMNS / 8];  // One bit per changed column within lo..hi
+    uint8_t frameStartline;  // Start line to send after the commit's data, or STE2007_SHADOW_UNKNOWN
+    // SPI trace ring; always present so the Object is the same size whether or not the driver has NOKIA1202_TRACE
+    DisplayNokia1202_Trace *trace;
 } DisplayNokia1202_Object;
 
+int ste2007_gray_attach(Display_Handle, DisplayNokia1202_Gray *);
+void ste2007_gray_retime(Display_Handle);
+int ste2007_gray_service(Display_Handle);  // call in a loop from the application's grayscale task
+int ste2007_gray_budget(Display_Handle, DisplayNokia1202_GrayBudget *);
+
+int ste2007_scrub(Display_Handle);  // call periodically from a low-priority task, see ste2007_scrub.c
+void ste2007_frame_clean(Display_Handle);
+
+//! @brief Maximum width of a numeric readout field in characters (one full line)
+#define NOKIA1202_NUMFIELD_MAXWIDTH (STE2007_COLUMNS / 6)
+
+/**
+ * @brief State for a right-aligned numeric readout, see ste2007_printint() and ste2007_printfixed()
+ * @details Owned by the application (one per readout) and set up with ste2007_numfield_init().  The driver remembers
+ *          which characters the field last put on the panel so that unchanged leading digits are never resent.  A field
+ *          is never moved: <line> must be 0-8 and <col> at most 90 or ste2007_numfield_init() returns false and leaves
+ *          it empty, and <width> is cut down to what fits before the right edge.
+ */
+typedef struct {
+    uint8_t line;
+    uint8_t col;
+    uint8_t width;
+    char pad;
+    char shown[NOKIA1202_NUMFIELD_MAXWIDTH];
+} DisplayNokia1202_NumField;
+
+bool ste2007_numfield_init(DisplayNokia1202_NumField *, uint8_t line, uint8_t col, uint8_t width, char pad);  // false if off the panel
+void ste2007_printint(Display_Handle, DisplayNokia1202_NumField *, int32_t val);
+void ste2007_printfixed(Display_Handle, DisplayNokia1202_NumField *, int32_t val, uint8_t qbits, uint8_t decimals);
+
+//! @brief Largest magnification supported by ste2007_printscaled()
+#define NOKIA1202_SCALE_MAX 3
+
+/**
+ * @brief printf in font_5x7 magnified <scale> times (1-NOKIA1202_SCALE_MAX) with its top-left corner at pixel column
+ *        <col> of page <line>
+ * @details The text occupies <scale> pages and 6*<scale> columns per character; it is clipped at the right edge of the
+ *          panel rather than wrapped, so every page goes out as a single transfer.  Takes the display's mutex.
+ */
+void ste2007_printscaled(Display_Handle, uint8_t line, uint8_t col, uint8_t scale, const char *fmt, ...);
+
 //! @brief Function table - this needs to be stuffed into your Display_config[] array for your <board>.c file
 extern const Display_FxnTable DisplayNokia1202_FxnTable;
 
@@ -189,5 +407,42 @@ extern const Display_FxnTable DisplayNokia1202_FxnTable;
 //! @details CMD_BACKLIGHT takes a uint8_t of 0 (off), !0 (on)
 #define NOKIA1202_CMD_BACKLIGHT             (DISPLAY_CMD_RESERVED + 4)
 
+//! @brief Display_control() command to attach an SPI trace ring (driver must be built with NOKIA1202_TRACE)
+//! @details CMD_TRACE takes a DisplayNokia1202_Trace * which must stay valid while attached, or NULL to detach
+#define NOKIA1202_CMD_TRACE                 (DISPLAY_CMD_RESERVED + 5)
+
+//! @brief Display_control() command to mirror or rotate the panel 180 degrees in hardware
+//! @details CMD_ORIENTATION takes a uint8_t of NOKIA1202_ORIENT_* flags
+#define NOKIA1202_CMD_ORIENTATION           (DISPLAY_CMD_RESERVED + 6)
+#define NOKIA1202_ORIENTATION_INVALID       (DISPLAY_STATUS_RESERVED - 2)
+
+//! @brief Display_control() command to attach a temporal-dithering grayscale region
+//! @details CMD_GRAYSCALE takes a DisplayNokia1202_Gray *, or NULL to stop; ste2007_gray_service() must then be run
+//!          in a loop from an application task
+#define NOKIA1202_CMD_GRAYSCALE             (DISPLAY_CMD_RESERVED + 7)
+#define NOKIA1202_GRAYSCALE_INVALID         (DISPLAY_STATUS_RESERVED - 3)
+
+//! @brief Display_control() command to report the SPI load of the grayscale engine
+//! @details CMD_GRAYBUDGET takes a DisplayNokia1202_GrayBudget * to fill in
+#define NOKIA1202_CMD_GRAYBUDGET            (DISPLAY_CMD_RESERVED + 8)
+
+//! @brief Display_control() command to change the share of the SPI bus ste2007_scrub() may use
+//! @details CMD_SCRUBRATE takes a uint16_t from 0 (scrubber off) to 1000; needs a shadowBuf in the HWAttrs
+#define NOKIA1202_CMD_SCRUBRATE             (DISPLAY_CMD_RESERVED + 9)
+#define NOKIA1202_SCRUBRATE_INVALID         (DISPLAY_STATUS_RESERVED - 6)
+
+//! @brief Display_control() commands to batch drawing into one update (needs a shadowBuf in the HWAttrs)
+//! @details CMD_FRAMEBEGIN (no argument) makes all drawing calls render into the shadow only; CMD_FRAMECOMMIT (no
+//!          argument) then sends everything that changed in address order while holding the display once.  Other
+//!          threads' drawing in between becomes part of the same frame.
+#define NOKIA1202_CMD_FRAMEBEGIN            (DISPLAY_CMD_RESERVED + 10)
+#define NOKIA1202_CMD_FRAMECOMMIT           (DISPLAY_CMD_RESERVED + 11)
+#define NOKIA1202_FRAME_INVALID             (DISPLAY_STATUS_RESERVED - 7)
+
+//! @brief Returned by the *_timeout API when the display was locked by another thread and timeout was 0
+#define NOKIA1202_STATUS_BUSY               (DISPLAY_STATUS_RESERVED - 4)
+//! @brief Returned by the *_timeout API when the display could not be locked in time or an SPI transfer timed out
+#define NOKIA1202_STATUS_TIMEOUT            (DISPLAY_STATUS_RESERVED - 5)
+
 
 #endif /* NOKIA1202_STE2007_H_ */
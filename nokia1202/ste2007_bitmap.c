@@ -0,0 +1,183 @@
+/**
+ * @file ste2007_bitmap.c
+ * @brief Nokia 1202 STE2007 TI Display Driver - Bitmap blitting with software rotation
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Row-major to column-byte conversion built on an 8x8 bit transpose.  With a row-major source, 0 and 180
+ *          degree output need the transpose while 90 and 270 degrees reduce to (at most) a bit reversal of each
+ *          source byte, since a source row already runs down a display column.
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "ste2007.h"
+#include "ste2007_bitmap.h"
+
+
+//! @brief Reverse the bit order of a byte
+static inline uint8_t ste2007_bitrev8(uint8_t b)
+{
+    b = (uint8_t)((b >> 4) | (b << 4));
+    b = (uint8_t)(((b & 0xCC) >> 2) | ((b & 0x33) << 2));
+    b = (uint8_t)(((b & 0xAA) >> 1) | ((b & 0x55) << 1));
+    return b;
+}
+
+void ste2007_transpose8x8(const uint8_t *rows, uint16_t stride, uint8_t cols[8])
+{
+    uint32_t x, y, t;
+
+    /* Rows are loaded bottom-up so that the MSB-first transpose below lands row 0 in bit 0 of each output byte
+     * (Hacker's Delight, transpose8rS32).
+     */
+    x = ((uint32_t)rows[7*stride] << 24) | ((uint32_t)rows[6*stride] << 16) | ((uint32_t)rows[5*stride] << 8) | rows[4*stride];
+    y = ((uint32_t)rows[3*stride] << 24) | ((uint32_t)rows[2*stride] << 16) | ((uint32_t)rows[1*stride] << 8) | rows[0];
+
+    t = (x ^ (x >> 7)) & 0x00AA00AA;  x = x ^ t ^ (t << 7);
+    t = (y ^ (y >> 7)) & 0x00AA00AA;  y = y ^ t ^ (t << 7);
+
+    t = (x ^ (x >> 14)) & 0x0000CCCC;  x = x ^ t ^ (t << 14);
+    t = (y ^ (y >> 14)) & 0x0000CCCC;  y = y ^ t ^ (t << 14);
+
+    t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+    y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+    x = t;
+
+    cols[0] = (uint8_t)(x >> 24);
+    cols[1] = (uint8_t)(x >> 16);
+    cols[2] = (uint8_t)(x >> 8);
+    cols[3] = (uint8_t)x;
+    cols[4] = (uint8_t)(y >> 24);
+    cols[5] = (uint8_t)(y >> 16);
+    cols[6] = (uint8_t)(y >> 8);
+    cols[7] = (uint8_t)y;
+}
+
+/**
+ * @brief Fetch 8 source pixels of row <y> starting at (possibly unaligned or negative) column <x0>, leftmost in bit 7
+ * @details Pixels outside the <w> x <h> bitmap read as 0.
+ */
+static uint8_t ste2007_fetch8(const uint8_t *bmp, uint16_t w, uint16_t h, uint16_t stride, int32_t y, int32_t x0)
+{
+    const uint8_t *row;
+    int32_t bx, sh, m;
+    uint16_t v;
+    uint8_t b = 0;
+
+    if (y < 0 || y >= h) {
+        return 0;
+    }
+    row = bmp + (uint32_t)y * stride;
+
+    if (x0 >= 0 && x0 + 8 <= w) {
+        // Fast path: fully inside, at most two source bytes
+        bx = x0 >> 3;
+        sh = x0 & 7;
+        v = (uint16_t)row[bx] << 8;
+        if (sh) {
+            v |= row[bx + 1];
+        }
+        return (uint8_t)((v << sh) >> 8);
+    }
+
+    for (m=0; m < 8; m++) {
+        if (x0 + m >= 0 && x0 + m < w && (row[(x0 + m) >> 3] & (0x80 >> ((x0 + m) & 7)))) {
+            b |= 0x80 >> m;
+        }
+    }
+    return b;
+}
+
+void ste2007_drawbitmap(Display_Handle dpyH, uint8_t x, uint8_t page, const uint8_t *bmp, uint16_t w, uint16_t h, uint16_t stride, uint8_t rotation)
+{
+    uint8_t line[STE2007_COLUMNS], blk[8], cols[8];
+    uint16_t sw, sh, ncols, npages, P, X, j, k;
+    int32_t sy, sx;
+
+    if (x >= STE2007_COLUMNS || page >= STE2007_PAGES) {
+        return;
+    }
+    rotation &= 0x03;
+    if (rotation == NOKIA1202_ROTATE_90 || rotation == NOKIA1202_ROTATE_270) {
+        sw = h;
+        sh = w;
+    } else {
+        sw = w;
+        sh = h;
+    }
+    ncols = (sw > STE2007_COLUMNS - x) ? STE2007_COLUMNS - x : sw;
+    npages = (sh + 7) / 8;
+    if (npages > STE2007_PAGES - page) {
+        npages = STE2007_PAGES - page;
+    }
+
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+
+    for (P=0; P < npages; P++) {
+        for (X=0; X < ncols; X += 8) {
+            switch (rotation) {
+                case NOKIA1202_ROTATE_0:
+                    // screen(X,Y) = src(X, Y)
+                    for (k=0; k < 8; k++) {
+                        blk[k] = ste2007_fetch8(bmp, w, h, stride, P*8 + k, X);
+                    }
+                    ste2007_transpose8x8(blk, 1, cols);
+                    break;
+
+                case NOKIA1202_ROTATE_180:
+                    // screen(X,Y) = src(w-1-X, h-1-Y)
+                    for (k=0; k < 8; k++) {
+                        blk[k] = ste2007_bitrev8(ste2007_fetch8(bmp, w, h, stride, (int32_t)h - 1 - (P*8 + k), (int32_t)w - 8 - X));
+                    }
+                    ste2007_transpose8x8(blk, 1, cols);
+                    break;
+
+                case NOKIA1202_ROTATE_90:
+                    // screen(X,Y) = src(Y, h-1-X): each source row segment is a display column, top pixel in bit 7
+                    for (j=0; j < 8; j++) {
+                        sy = (int32_t)h - 1 - (X + j);
+                        cols[j] = ste2007_bitrev8(ste2007_fetch8(bmp, w, h, stride, sy, P*8));
+                    }
+                    break;
+
+                default:  // NOKIA1202_ROTATE_270
+                    // screen(X,Y) = src(w-1-Y, X): source row segment read right-to-left lands top pixel in bit 0
+                    for (j=0; j < 8; j++) {
+                        sx = (int32_t)w - 8 - P*8;
+                        cols[j] = ste2007_fetch8(bmp, w, h, stride, X + j, sx);
+                    }
+                    break;
+            }
+            for (j=0; j < 8 && X + j < ncols; j++) {
+                line[X + j] = cols[j];
+            }
+        }
+
+        ste2007_setxy(dpyH, x, page + P);
+        ste2007_chipselect(dpyH, 0);
+        ste2007_write(dpyH, line, ncols);
+        ste2007_chipselect(dpyH, 1);
+    }
+
+    ste2007_unlock(dpyH);
+}
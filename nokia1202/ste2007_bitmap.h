@@ -0,0 +1,57 @@
+/**
+ * @file ste2007_bitmap.h
+ * @brief Nokia 1202 STE2007 TI Display Driver - Bitmap blitting with software rotation
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Draws row-major 1bpp bitmaps (MSB = leftmost pixel, as produced by most image converters) into the
+ *          STE2007's column-byte pages, optionally rotated by 90/180/270 degrees for portrait-mounted panels.
+ *          Mirroring and 180 degree rotation of the whole panel are better done in hardware with
+ *          NOKIA1202_CMD_ORIENTATION; this is for content that has to be rotated in software.
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOKIA1202_STE2007_BITMAP_H_
+#define NOKIA1202_STE2007_BITMAP_H_
+
+#include <stdint.h>
+#include <ti/display/Display.h>
+#include "ste2007.h"
+
+//! @brief Rotation (clockwise) for ste2007_drawbitmap()
+#define NOKIA1202_ROTATE_0      0
+#define NOKIA1202_ROTATE_90     1
+#define NOKIA1202_ROTATE_180    2
+#define NOKIA1202_ROTATE_270    3
+
+/**
+ * @brief 8x8 bit-matrix transpose from row-major bytes to STE2007 column bytes
+ * @details rows[k * stride] holds pixel row k of the block with the leftmost pixel in bit 7.  On return cols[j] holds
+ *          pixel column j with row 0 in bit 0, i.e. exactly what the STE2007 expects for one page.  Branch-free SWAR
+ *          on two 32-bit words.
+ */
+void ste2007_transpose8x8(const uint8_t *rows, uint16_t stride, uint8_t cols[8]);
+
+/**
+ * @brief Draw a row-major 1bpp bitmap with its top-left corner at pixel column <x> of page <page>
+ * @details <w> x <h> is the bitmap size in pixels before rotation and <stride> the number of bytes per source row.
+ *          The rotated image is clipped to the panel and drawn opaque; rows past the bottom of the image in its last
+ *          page are cleared.  Each page is sent as one transfer.  Takes the display's mutex.
+ */
+void ste2007_drawbitmap(Display_Handle, uint8_t x, uint8_t page, const uint8_t *bmp, uint16_t w, uint16_t h, uint16_t stride, uint8_t rotation);
+
+
+#endif /* NOKIA1202_STE2007_BITMAP_H_ */
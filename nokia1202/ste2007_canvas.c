@@ -0,0 +1,196 @@
+/**
+ * @file ste2007_canvas.c
+ * @brief Nokia 1202 STE2007 TI Display Driver - Virtual canvas with a scrolling viewport
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Viewport painting and panning for DisplayNokia1202_Canvas, see ste2007_canvas.h.
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "ste2007.h"
+#include "ste2007_canvas.h"
+
+
+// DDRAM pages 0-7 rotate under the start line; page 8 always shows the bottom page of the viewport
+#define CANVAS_RING (STE2007_PAGES - 1)
+
+
+bool ste2007_canvas_init(DisplayNokia1202_Canvas *cv, uint8_t *buf, uint16_t width, uint8_t pages)
+{
+    if (buf == NULL || width < STE2007_COLUMNS || pages < STE2007_PAGES) {
+        return false;
+    }
+    cv->buf = buf;
+    cv->width = width;
+    cv->pages = pages;
+    cv->viewX = 0;
+    cv->viewPage = 0;
+    cv->ringTop = STE2007_SHADOW_UNKNOWN;
+    return true;
+}
+
+//! @brief Send panel columns <c0>..<c1> of visible canvas page <cp>; caller holds the mutex
+static void ste2007_canvas_send(Display_Handle dpyH, void *arg, uint8_t cp, uint8_t c0, uint8_t c1)
+{
+    DisplayNokia1202_Canvas *cv = (DisplayNokia1202_Canvas *)arg;
+    uint8_t k = cp - cv->viewPage;
+
+    ste2007_setxy(dpyH, c0, (k < CANVAS_RING) ? (cv->ringTop + k) % CANVAS_RING : k);
+    ste2007_chipselect(dpyH, 0);
+    ste2007_write(dpyH, &cv->buf[(uint32_t)cp * cv->width + cv->viewX + c0], c1 - c0 + 1);
+    ste2007_chipselect(dpyH, 1);
+}
+
+//! @brief Repaint the viewport with the ring reset to DDRAM page 0; caller holds the mutex
+static void ste2007_canvas_paint(Display_Handle dpyH, DisplayNokia1202_Canvas *cv)
+{
+    uint8_t k;
+
+    cv->ringTop = 0;
+    ste2007_setxy(dpyH, 0, 0);
+    ste2007_chipselect(dpyH, 0);
+    for (k=0; k < STE2007_PAGES; k++) {  // One chip select; the column auto-wrap steps through the pages
+        ste2007_write(dpyH, &cv->buf[(uint32_t)(cv->viewPage + k) * cv->width + cv->viewX], STE2007_COLUMNS);
+    }
+    ste2007_chipselect(dpyH, 1);
+    ste2007_startline(dpyH, 0);
+}
+
+/**
+ * @brief Bring the DDRAM page of visible canvas page <cp> from showing the 96 bytes at <was> to showing the viewport
+ * @details Only runs of columns whose byte changes are sent; caller holds the mutex.
+ */
+static void ste2007_canvas_diff(Display_Handle dpyH, DisplayNokia1202_Canvas *cv, uint8_t cp, const uint8_t *was)
+{
+    const uint8_t *now = &cv->buf[(uint32_t)cp * cv->width + cv->viewX];
+    DisplayNokia1202_Run run;
+    uint8_t c;
+
+    ste2007_run_init(&run, dpyH, cp, ste2007_canvas_send, cv);
+    for (c=0; c < STE2007_COLUMNS; c++) {
+        if (was[c] != now[c]) {
+            ste2007_run_add(&run, c);
+        }
+    }
+    ste2007_run_flush(&run);
+}
+
+void ste2007_canvas_show(Display_Handle dpyH, DisplayNokia1202_Canvas *cv)
+{
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+    ste2007_canvas_paint(dpyH, cv);
+    if (ste2007_unlock(dpyH) != DISPLAY_STATUS_SUCCESS) {
+        cv->ringTop = STE2007_SHADOW_UNKNOWN;  // Bus timed out partway; repaint in full next time
+    }
+}
+
+/**
+ * @brief Move the viewport
+ * @details Pages scrolled into the ring are written in full into the DDRAM pages that scrolled out and the start line
+ *          is moved to match; ring pages that stay in view are only diffed when the pan is also horizontal.  DDRAM
+ *          page 8 does not move, so it is diffed against what it showed before.
+ */
+void ste2007_canvas_pan(Display_Handle dpyH, DisplayNokia1202_Canvas *cv, uint16_t x, uint8_t page)
+{
+    uint16_t oldX;
+    uint8_t oldPage, cp;
+    int dy;
+
+    if (x > cv->width - STE2007_COLUMNS) {
+        x = cv->width - STE2007_COLUMNS;
+    }
+    if (page > cv->pages - STE2007_PAGES) {
+        page = cv->pages - STE2007_PAGES;
+    }
+    if (x == cv->viewX && page == cv->viewPage && cv->ringTop != STE2007_SHADOW_UNKNOWN) {
+        return;
+    }
+
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+
+    dy = (int)page - cv->viewPage;
+    if (cv->ringTop == STE2007_SHADOW_UNKNOWN || dy <= -CANVAS_RING || dy >= CANVAS_RING) {
+        cv->viewX = x;
+        cv->viewPage = page;
+        ste2007_canvas_paint(dpyH, cv);
+    } else {
+        oldX = cv->viewX;
+        oldPage = cv->viewPage;
+        // From here on ste2007_canvas_send() addresses the new viewport
+        cv->viewX = x;
+        cv->viewPage = page;
+        cv->ringTop = (uint8_t)((cv->ringTop + CANVAS_RING + dy) % CANVAS_RING);
+
+        for (cp=page; cp < page + CANVAS_RING; cp++) {
+            if (cp < oldPage || cp >= oldPage + CANVAS_RING) {
+                ste2007_canvas_send(dpyH, cv, cp, 0, STE2007_COLUMNS - 1);
+            } else if (x != oldX) {
+                ste2007_canvas_diff(dpyH, cv, cp, &cv->buf[(uint32_t)cp * cv->width + oldX]);
+            }
+        }
+        ste2007_canvas_diff(dpyH, cv, page + CANVAS_RING, &cv->buf[(uint32_t)(oldPage + CANVAS_RING) * cv->width + oldX]);
+        ste2007_startline(dpyH, cv->ringTop * 8);
+    }
+
+    if (ste2007_unlock(dpyH) != DISPLAY_STATUS_SUCCESS) {
+        cv->ringTop = STE2007_SHADOW_UNKNOWN;
+    }
+}
+
+void ste2007_canvas_update(Display_Handle dpyH, DisplayNokia1202_Canvas *cv, uint8_t page, uint16_t x, uint16_t w)
+{
+    uint32_t c0, c1;
+
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+
+    if (cv->ringTop == STE2007_SHADOW_UNKNOWN) {
+        ste2007_canvas_paint(dpyH, cv);
+    } else if (page >= cv->viewPage && page < cv->viewPage + STE2007_PAGES) {
+        c0 = (x > cv->viewX) ? x : cv->viewX;
+        c1 = ((uint32_t)x + w < (uint32_t)cv->viewX + STE2007_COLUMNS) ? (uint32_t)x + w : (uint32_t)cv->viewX + STE2007_COLUMNS;
+        if (c0 < c1) {
+            ste2007_canvas_send(dpyH, cv, page, c0 - cv->viewX, c1 - 1 - cv->viewX);
+        }
+    }
+
+    if (ste2007_unlock(dpyH) != DISPLAY_STATUS_SUCCESS) {
+        cv->ringTop = STE2007_SHADOW_UNKNOWN;
+    }
+}
+
+void ste2007_canvas_hide(Display_Handle dpyH, DisplayNokia1202_Canvas *cv)
+{
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+    ste2007_startline(dpyH, 0);
+    cv->ringTop = STE2007_SHADOW_UNKNOWN;
+    ste2007_unlock(dpyH);
+
+    ste2007_clear(dpyH);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file ste2007_canvas.h
+ * @brief Nokia 1202 STE2007 TI Display Driver - Virtual canvas with a scrolling viewport
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details A canvas is an application-owned RAM image larger than the panel, in DDRAM format (column bytes, one page
+ *          of <width> bytes after another), and the panel shows a 96 x 9-page viewport of it.  Draw into buf[]
+ *          directly or with ste2007_font_render(), then push the changed area with ste2007_canvas_update().
+ *
+ *          Vertical pans go through the STE2007's display start line.  Its register only reaches row 63, so DDRAM
+ *          pages 0-7 are used as a ring for the top 8 pages of the viewport and page 8 (the half page at the bottom)
+ *          is kept outside it: scrolling by n pages writes only the n newly exposed pages into the ring, diffs page 8
+ *          and moves the start line.  This relies on the controller wrapping the start line within the 64 rows of
+ *          pages 0-7; that has not been checked on a panel.  Horizontal pans compare the old and new column bytes of
+ *          every visible page and send only the runs that differ.  Inside a frame (NOKIA1202_CMD_FRAMEBEGIN) the
+ *          start line is sent with the commit, after the pages it exposes.
+ *
+ *          While a canvas is shown it owns the whole panel; call ste2007_canvas_hide() before going back to the
+ *          regular Display_* API.  All functions that take a Display_Handle take the display's mutex.
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOKIA1202_STE2007_CANVAS_H_
+#define NOKIA1202_STE2007_CANVAS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ti/display/Display.h>
+#include "ste2007.h"
+
+typedef struct {
+    uint8_t *buf;           // <pages> x <width> bytes; canvas page p starts at buf[p * width]
+    uint16_t width;         // In pixels, at least STE2007_COLUMNS
+    uint8_t pages;          // In 8-pixel pages, at least STE2007_PAGES
+    uint16_t viewX;         // Canvas column shown in the panel's leftmost column
+    uint8_t viewPage;       // Canvas page shown in the panel's top page
+    uint8_t ringTop;        // DDRAM page (0-7) scanned out at the top, STE2007_SHADOW_UNKNOWN while not shown
+} DisplayNokia1202_Canvas;
+
+//! @brief Set up a canvas over <buf>; returns false if it is smaller than the panel
+bool ste2007_canvas_init(DisplayNokia1202_Canvas *, uint8_t *buf, uint16_t width, uint8_t pages);
+//! @brief Paint the whole viewport (also done by the first pan or update)
+void ste2007_canvas_show(Display_Handle, DisplayNokia1202_Canvas *);
+//! @brief Move the viewport so canvas column <x>, page <page> is at the top left; clamped to the canvas
+void ste2007_canvas_pan(Display_Handle, DisplayNokia1202_Canvas *, uint16_t x, uint8_t page);
+//! @brief Send the visible part of a <w> column wide area at canvas column <x> of canvas page <page>
+void ste2007_canvas_update(Display_Handle, DisplayNokia1202_Canvas *, uint8_t page, uint16_t x, uint16_t w);
+//! @brief Put the start line back to 0 and clear the panel so the regular Display_* API lines up again
+void ste2007_canvas_hide(Display_Handle, DisplayNokia1202_Canvas *);
+
+
+#endif /* NOKIA1202_STE2007_CANVAS_H_ */
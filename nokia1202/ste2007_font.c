@@ -0,0 +1,151 @@
+/**
+ * @file ste2007_font.c
+ * @brief Nokia 1202 STE2007 TI Display Driver - Compiled font rendering
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Text output for fonts described by DisplayNokia1202_Font (see ste2007_font.h and tools/ste2007_fontc.c).
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <ti/drivers/SPI.h>
+
+#include "spitxn.h"
+#include "ste2007.h"
+#include "ste2007_font.h"
+
+
+//! @brief Map a character to a glyph number - a dense table lookup
+static uint8_t ste2007_font_glyph(const DisplayNokia1202_Font *f, unsigned char c)
+{
+    uint8_t g;
+
+    if (c < f->first || c > f->last) {
+        return f->defaultGlyph;
+    }
+    if (f->index == NULL) {
+        return c - f->first;
+    }
+    g = f->index[c - f->first];
+    return (g == NOKIA1202_FONT_NOGLYPH) ? f->defaultGlyph : g;
+}
+
+//! @brief Send whatever is staged in the row buffer
+static void ste2007_font_flush(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    SPI_Transaction txn;
+
+    if (o->rowbuffer.len == 0) {
+        return;
+    }
+    txn.count = o->rowbuffer.len;
+    txn.txBuf = (void *)(o->rowbuffer.buf);
+    txn.rxBuf = (void *)0;
+    ste2007_spitransfer(dpyH, &txn);
+    ste2007_advancecursor(dpyH, txn.count);
+    spitxn_reset(&(o->rowbuffer));
+}
+
+void ste2007_drawtext(Display_Handle dpyH, const DisplayNokia1202_Font *font, uint8_t line, uint8_t col, const char *str)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    SPI_Transaction txn;
+    const char *c;
+    uint32_t start, at;
+    uint16_t w, n, room;
+    uint8_t g, p;
+
+    if (col >= STE2007_COLUMNS) {
+        return;
+    }
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+
+    for (p=0; p < font->pages && line + p < STE2007_PAGES; p++) {
+        ste2007_setxy(dpyH, col, line + p);
+        ste2007_chipselect(dpyH, 0);
+        spitxn_reset(&(o->rowbuffer));
+        room = STE2007_COLUMNS - col;
+
+        for (c=str; *c && room > 0; c++) {
+            g = ste2007_font_glyph(font, (unsigned char)*c);
+            if (font->offset != NULL) {
+                start = font->offset[g];
+                w = font->offset[g + 1] - start;
+            } else {
+                start = (uint32_t)g * font->fixedWidth;
+                w = font->fixedWidth;
+            }
+            at = start * font->pages + (uint32_t)p * w;
+            n = (w > room) ? room : w;
+            room -= n;
+
+            if (font->tagged != NULL) {
+                // Already in wire format - hand the flash copy straight to the SPI driver
+                ste2007_font_flush(dpyH);
+                txn.count = n;
+                txn.txBuf = (void *)&font->tagged[at];
+                txn.rxBuf = (void *)0;
+                ste2007_spitransfer(dpyH, &txn);
+                ste2007_advancecursor(dpyH, txn.count);
+            } else {
+                if ((o->rowbuffer.cap - o->rowbuffer.len) < n) {
+                    ste2007_font_flush(dpyH);
+                }
+                spitxn_push(&(o->rowbuffer), 0x01, (uint8_t *)&font->bitmap[at], n);
+            }
+        }
+        ste2007_font_flush(dpyH);
+        ste2007_chipselect(dpyH, 1);
+    }
+
+    ste2007_unlock(dpyH);
+}
+
+uint16_t ste2007_font_render(const DisplayNokia1202_Font *font, const char *str, uint8_t *dst, uint16_t stride, uint16_t maxw)
+{
+    const char *c;
+    uint32_t start, at;
+    uint16_t w, n, i, x = 0;
+    uint8_t g, p;
+
+    for (c=str; *c && x < maxw; c++) {
+        g = ste2007_font_glyph(font, (unsigned char)*c);
+        if (font->offset != NULL) {
+            start = font->offset[g];
+            w = font->offset[g + 1] - start;
+        } else {
+            start = (uint32_t)g * font->fixedWidth;
+            w = font->fixedWidth;
+        }
+        n = (w > maxw - x) ? maxw - x : w;
+        for (p=0; p < font->pages; p++) {
+            at = start * font->pages + (uint32_t)p * w;
+            for (i=0; i < n; i++) {
+                dst[p * stride + x + i] = (font->tagged != NULL) ? (uint8_t)font->tagged[at + i] : font->bitmap[at + i];
+            }
+        }
+        x += n;
+    }
+    return x;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file ste2007_font.h
+ * @brief Nokia 1202 STE2007 TI Display Driver - Compiled font tables
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Font description consumed by ste2007_drawtext().  Font headers are generated on the host from BDF files by
+ *          tools/ste2007_fontc.c, which can subset the font to the characters an application uses, emit proportional
+ *          widths and pre-tag the columns as 9-bit DDRAM words.  The built-in 5x7 font is available as
+ *          ste2007_font5x7.
+ *
+ *          Glyph data is stored glyph after glyph; within a glyph of width w spanning <pages> pages, page p's column
+ *          bytes are at [start*pages + p*w ... + w-1], where <start> is the glyph's first column (offset[] entry, or
+ *          glyph * fixedWidth).  Bit 0 of each byte is the top pixel row of the page, as in DDRAM.
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOKIA1202_STE2007_FONT_H_
+#define NOKIA1202_STE2007_FONT_H_
+
+#include <stdint.h>
+#include <ti/display/Display.h>
+
+//! @brief index[] entry for a character that is not in the (subsetted) font
+#define NOKIA1202_FONT_NOGLYPH 0xFF
+
+typedef struct {
+    uint8_t pages;              // Height in 8-pixel pages
+    uint8_t first;              // First character code covered by index[]
+    uint8_t last;               // Last character code covered by index[]
+    uint8_t defaultGlyph;       // Drawn for characters outside first..last or without a glyph
+    uint8_t fixedWidth;         // Glyph width when offset[] is NULL
+    const uint8_t *index;       // (last - first + 1) glyph numbers or NOKIA1202_FONT_NOGLYPH; NULL means glyph = c - first
+    const uint16_t *offset;     // Proportional fonts: glyph n spans columns offset[n] .. offset[n+1]-1; NULL if fixed
+    const uint8_t *bitmap;      // Column bytes, or NULL when the font was compiled pre-tagged
+    const uint16_t *tagged;     // Same layout as bitmap[] with the 9th (data) bit already set, sent straight from flash
+} DisplayNokia1202_Font;
+
+//! @brief The driver's built-in 6x8 cell (5x7 glyph) font, the one Display_printf() uses
+extern const DisplayNokia1202_Font ste2007_font5x7;
+
+/**
+ * @brief Draw <str> in <font> with its top-left corner at pixel column <col> of page <line>
+ * @details Each page of the text is sent as one chip select.  Text running past the right edge of the panel is
+ *          clipped.  Takes the display's mutex.
+ */
+void ste2007_drawtext(Display_Handle, const DisplayNokia1202_Font *font, uint8_t line, uint8_t col, const char *str);
+
+/**
+ * @brief Render <str> in <font> into a RAM buffer in DDRAM (column-byte page) format instead of the panel
+ * @details Page p of the text goes to dst[p * stride ...].  At most <maxw> columns are written.
+ * @return Number of columns written
+ */
+uint16_t ste2007_font_render(const DisplayNokia1202_Font *font, const char *str, uint8_t *dst, uint16_t stride, uint16_t maxw);
+
+
+#endif /* NOKIA1202_STE2007_FONT_H_ */
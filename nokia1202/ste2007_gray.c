@@ -0,0 +1,330 @@
+/**
+ * @file ste2007_gray.c
+ * @brief Nokia 1202 STE2007 TI Display Driver - Temporal-dithering grayscale
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Frame-rate modulation for 4 apparent gray levels on the 1bpp STE2007.  A region of the panel is described by
+ *          two bitplanes (hi, lo) in column-byte page format; the 2-bit level of each pixel is (hi << 1) | lo.  The
+ *          engine cycles through 3 phases, showing a pixel in (level) of them:
+ *          @n phase 0: hi | lo     phase 1: hi     phase 2: hi & lo
+ *
+ *          A ClockP running at (refresh rate / divisor) posts a semaphore, and the application runs
+ *          ste2007_gray_service() in a loop from a task of its own choosing, so SPI traffic never happens in Swi
+ *          context and the task's priority bounds the jitter.  Only pages where hi and lo differ somewhere are
+ *          streamed (the planes are rescanned every phase); the rest of the region is written once at attach time.
+ *          The STE2007 has no frame sync output, so phases are paced to the configured refresh rate rather than locked
+ *          to it; a divisor of 2 or more makes the beat between the two much less visible.
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <ti/drivers/SPI.h>
+#include <ti/drivers/dpl/ClockP.h>
+#include <ti/drivers/dpl/SemaphoreP.h>
+
+#include "spitxn.h"
+#include "ste2007.h"
+
+#define GRAY_PHASES 3
+
+
+//! @brief ClockP callback - runs in Swi context so it only wakes the service task
+static void ste2007_gray_tick(uintptr_t arg)
+{
+    DisplayNokia1202_Object *o = (DisplayNokia1202_Object *)arg;
+
+    SemaphoreP_post(o->graySem);
+}
+
+//! @brief ClockP period in ticks for one phase at the current refresh rate
+static uint32_t ste2007_gray_period(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    uint32_t hz = (o->refreshrate == STE2007_SHADOW_UNKNOWN) ? 65 : o->refreshrate;
+    uint32_t ticks;
+
+    ticks = ((uint32_t)o->gray->divisor * 1000000UL) / (hz * ClockP_getSystemTickPeriod());
+    return (ticks > 0) ? ticks : 1;
+}
+
+//! @brief Stage one page of the region for <phase> into the row buffer
+static void ste2007_gray_stage(Display_Handle dpyH, uint8_t page, uint8_t phase)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    const DisplayNokia1202_Gray *g = o->gray;
+    uint32_t idx = (uint32_t)(page - g->firstPage) * g->width;
+    uint16_t i;
+    uint8_t hi, lo, v;
+
+    for (i=0; i < g->width; i++, idx++) {
+        hi = g->planeHi[idx];
+        lo = g->planeLo[idx];
+        if (phase == 0) {
+            v = hi | lo;
+        } else if (phase == 1) {
+            v = hi;
+        } else {
+            v = hi & lo;
+        }
+        o->rowbuffer.buf[i] = 0x0100 | v;
+    }
+    o->rowbuffer.len = g->width;
+}
+
+/**
+ * @brief Send <phase> of every page in <pageMask>; caller holds the mutex
+ * @details Chip Select stays asserted across pages whose start the cursor already sits at (a full-width region), so
+ *          such a region goes out as a single transaction.
+ */
+static void ste2007_gray_send(Display_Handle dpyH, uint16_t pageMask, uint8_t phase)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    const DisplayNokia1202_Gray *g = o->gray;
+    SPI_Transaction txn;
+    uint8_t p;
+    bool selected = false;
+    bool frame = o->frameOpen;
+
+    if (frame) {
+        // Modulation phases are due now, not at the next frame commit
+        o->frameOpen = false;
+        o->curX = STE2007_SHADOW_UNKNOWN;
+        o->curY = STE2007_SHADOW_UNKNOWN;
+    }
+    for (p=g->firstPage; p < g->firstPage + g->numPages; p++) {
+        if (!(pageMask & (1 << p))) {
+            continue;
+        }
+        if (o->curX != g->col || o->curY != p) {
+            if (selected) {
+                ste2007_chipselect(dpyH, 1);
+                selected = false;
+            }
+            ste2007_setxy(dpyH, g->col, p);
+        }
+        if (!selected) {
+            ste2007_chipselect(dpyH, 0);
+            selected = true;
+        }
+        ste2007_gray_stage(dpyH, p, phase);
+        txn.count = o->rowbuffer.len;
+        txn.txBuf = (void *)(o->rowbuffer.buf);
+        txn.rxBuf = (void *)0;
+        ste2007_spitransfer(dpyH, &txn);
+        ste2007_advancecursor(dpyH, txn.count);
+    }
+    if (selected) {
+        ste2007_chipselect(dpyH, 1);
+    }
+    if (frame) {
+        o->frameOpen = true;
+    }
+}
+
+//! @brief Stop and release the phase clock; caller holds the mutex
+static void ste2007_gray_stopclock(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    if (o->grayClock != NULL) {
+        ClockP_stop(o->grayClock);
+        ClockP_delete(o->grayClock);
+        o->grayClock = NULL;
+    }
+}
+
+//! @brief (Re)create the phase clock for the current refresh rate; caller holds the mutex
+static int ste2007_gray_startclock(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    ClockP_Params cp;
+    uint32_t period;
+
+    ste2007_gray_stopclock(dpyH);
+
+    period = ste2007_gray_period(dpyH);
+    ClockP_Params_init(&cp);
+    cp.period = period;
+    cp.startFlag = true;
+    cp.arg = (uintptr_t)o;
+    o->grayClock = ClockP_create(ste2007_gray_tick, period, &cp);
+
+    return (o->grayClock == NULL) ? DISPLAY_STATUS_ERROR : DISPLAY_STATUS_SUCCESS;
+}
+
+//! @brief Pages of the region where some pixel has hi != lo, i.e. which look any different between phases
+static uint16_t ste2007_gray_scan(const DisplayNokia1202_Gray *g)
+{
+    uint32_t idx, end;
+    uint16_t mask = 0;
+    uint8_t p;
+
+    for (p=g->firstPage; p < g->firstPage + g->numPages; p++) {
+        idx = (uint32_t)(p - g->firstPage) * g->width;
+        for (end = idx + g->width; idx < end; idx++) {
+            if (g->planeHi[idx] ^ g->planeLo[idx]) {
+                mask |= 1 << p;
+                break;
+            }
+        }
+    }
+    return mask;
+}
+
+/**
+ * @brief Attach (or with NULL, detach) a grayscale region - NOKIA1202_CMD_GRAYSCALE handler
+ * @details Caller holds the mutex.  On detach the region is left showing phase 0 (every nonzero level as black) and a
+ *          task blocked in ste2007_gray_service() is woken up so it can see the engine has stopped.
+ */
+int ste2007_gray_attach(Display_Handle dpyH, DisplayNokia1202_Gray *g)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    if (g == NULL) {
+        if (o->gray != NULL) {
+            ste2007_gray_stopclock(dpyH);
+            ste2007_gray_send(dpyH, o->grayPages, 0);
+            o->gray = NULL;
+            o->grayPages = 0;
+            SemaphoreP_post(o->graySem);
+        }
+        return DISPLAY_STATUS_SUCCESS;
+    }
+
+    if (g->planeHi == NULL || g->planeLo == NULL || g->numPages == 0 || g->width == 0 || g->divisor == 0 ||
+        g->firstPage + g->numPages > STE2007_PAGES || g->col + g->width > STE2007_COLUMNS) {
+        return NOKIA1202_GRAYSCALE_INVALID;
+    }
+
+    if (o->graySem == NULL) {
+        o->graySem = SemaphoreP_createBinary(0);
+        if (o->graySem == NULL) {
+            return DISPLAY_STATUS_ERROR;
+        }
+    }
+    // Drop a wakeup left over from an earlier detach that no task was waiting for, so the first phase is paced
+    while (SemaphoreP_pend(o->graySem, SemaphoreP_NO_WAIT) == SemaphoreP_OK)
+        ;
+
+    o->gray = g;
+    o->grayPages = ste2007_gray_scan(g);
+
+    // Draw the whole region once; from here on only the gray pages are refreshed
+    ste2007_gray_send(dpyH, ((1 << (g->firstPage + g->numPages)) - 1) & ~((1 << g->firstPage) - 1), 0);
+    o->grayPhase = 0;
+
+    if (ste2007_gray_startclock(dpyH) != DISPLAY_STATUS_SUCCESS) {
+        o->gray = NULL;
+        o->grayPages = 0;
+        return DISPLAY_STATUS_ERROR;
+    }
+    return DISPLAY_STATUS_SUCCESS;
+}
+
+//! @brief Re-pace the phase clock after the refresh rate changed; caller holds the mutex
+void ste2007_gray_retime(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    if (o->gray != NULL) {
+        ste2007_gray_startclock(dpyH);
+    }
+}
+
+/**
+ * @brief Grayscale refresh engine - call in a loop from a dedicated task
+ * @details Blocks until the next phase is due, then streams it to every page holding gray content.  The bitplanes are
+ *          rescanned every phase, so pages that gain gray pixels are picked up and pages that lose all of them get a
+ *          final update.  Pages that stay solid (hi == lo throughout) are not resent: after changing their contents,
+ *          attach the region again with NOKIA1202_CMD_GRAYSCALE to redraw it.
+ * @return DISPLAY_STATUS_SUCCESS after a phase has been sent, DISPLAY_STATUS_ERROR once no region is attached, or
+ *         NOKIA1202_STATUS_TIMEOUT if the display could not be locked or the bus timed out
+ */
+int ste2007_gray_service(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    uint16_t pages;
+    int ret;
+
+    if (o->graySem == NULL) {
+        return DISPLAY_STATUS_ERROR;
+    }
+    SemaphoreP_pend(o->graySem, SemaphoreP_WAIT_FOREVER);
+
+    ret = ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT);
+    if (ret != DISPLAY_STATUS_SUCCESS) {
+        return ret;  // Phase skipped; the next tick tries again
+    }
+    if (o->gray == NULL) {
+        ste2007_unlock(dpyH);
+        return DISPLAY_STATUS_ERROR;
+    }
+    o->grayPhase++;
+    if (o->grayPhase >= GRAY_PHASES) {
+        o->grayPhase = 0;
+    }
+    // Pages that just turned solid look the same in every phase, so this last send leaves them correct
+    pages = ste2007_gray_scan(o->gray);
+    ste2007_gray_send(dpyH, pages | o->grayPages, o->grayPhase);
+    o->grayPages = pages;
+
+    return ste2007_unlock(dpyH);
+}
+
+/**
+ * @brief Report the SPI load of the attached grayscale region - NOKIA1202_CMD_GRAYBUDGET handler
+ * @details Counts a full 3-word cursor move for each page that cannot be chained to the previous one.
+ */
+int ste2007_gray_budget(Display_Handle dpyH, DisplayNokia1202_GrayBudget *b)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    const DisplayNokia1202_Gray *g = o->gray;
+    uint32_t hz = (o->refreshrate == STE2007_SHADOW_UNKNOWN) ? 65 : o->refreshrate;
+    uint8_t p;
+    bool chained = false;
+
+    b->grayPages = 0;
+    b->wordsPerPhase = 0;
+    b->phasesPerSecond = 0;
+    b->bitsPerSecond = 0;
+    b->busPermille = 0;
+    if (g == NULL) {
+        return DISPLAY_STATUS_SUCCESS;
+    }
+
+    for (p=g->firstPage; p < g->firstPage + g->numPages; p++) {
+        if (!(o->grayPages & (1 << p))) {
+            chained = false;
+            continue;
+        }
+        b->grayPages++;
+        b->wordsPerPhase += g->width;
+        if (!chained) {
+            b->wordsPerPhase += 3;
+        }
+        chained = (g->col == 0 && g->width == STE2007_COLUMNS);
+    }
+    b->phasesPerSecond = hz / g->divisor;
+    b->bitsPerSecond = (b->wordsPerPhase * 9UL * hz) / g->divisor;
+    b->busPermille = (uint16_t)((b->bitsPerSecond * 1000ULL) / NOKIA1202_SPI_BITRATE);
+
+    return DISPLAY_STATUS_SUCCESS;
+}
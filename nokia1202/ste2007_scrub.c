@@ -0,0 +1,159 @@
+/**
+ * @file ste2007_scrub.c
+ * @brief Nokia 1202 STE2007 TI Display Driver - Background DDRAM scrubber
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details ESD can flip DDRAM bits or knock the STE2007's analog settings out, and the damage stays until the
+ *          application happens to repaint.  When DisplayNokia1202_HWAttrsV1.shadowBuf is supplied, every DDRAM byte the
+ *          driver sends is also kept there (see ste2007_spitransfer()), and ste2007_scrub() rewrites the panel from it a
+ *          page at a time, round robin.  After each full pass the VOP, bias and electronic volume registers are sent
+ *          again as well.
+ *
+ *          The application calls ste2007_scrub() periodically from a low-priority task.  It never waits for the
+ *          display: if a foreground update holds the mutex it returns NOKIA1202_STATUS_BUSY straight away, and it
+ *          writes at most NOKIA1202_SCRUB_MAXPAGES pages per call so it only ever holds the bus briefly.  Its average
+ *          SPI load is capped by a token bucket at scrubPermille/1000 of NOKIA1202_SPI_BITRATE; e.g. 20 permille
+ *          rewrites the whole panel about twice a second at 1MHz, given at least 12 calls a second.  Pages covered by
+ *          a grayscale region are skipped, and so are stale pages whose shadow copy may not match the panel after an SPI
+ *          failure, until the application rewrites them in full (a Display_clear() does).
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <ti/drivers/SPI.h>
+#include <ti/drivers/dpl/ClockP.h>
+
+#include "spitxn.h"
+#include "ste2007.h"
+
+//! @brief Pages rewritten per ste2007_scrub() call at most
+#define NOKIA1202_SCRUB_MAXPAGES 2
+
+// Token bucket units: one microsecond of bus time at a rate of 1 permille.  9e9 does not fit in a 32-bit long.
+#define SCRUB_WORD_COST     (9ULL * 1000000000ULL / NOKIA1202_SPI_BITRATE)
+#define SCRUB_PAGE_WORDS    (3 + STE2007_COLUMNS)   // Cursor move + one page of data
+#define SCRUB_REG_WORDS     4                       // VOP (2 words), bias, electronic volume
+#define SCRUB_BUCKET        ((NOKIA1202_SCRUB_MAXPAGES * SCRUB_PAGE_WORDS + SCRUB_REG_WORDS) * SCRUB_WORD_COST)
+
+#if SCRUB_WORD_COST == 0 || SCRUB_BUCKET > 0xFFFFFFFFULL
+#error "NOKIA1202_SPI_BITRATE gives a scrubber word cost or bucket size that DisplayNokia1202_Object.scrubCredit cannot hold"
+#endif
+
+
+//! @brief Add the credit earned since the last call at scrubPermille
+static void ste2007_scrub_refill(DisplayNokia1202_Object *o)
+{
+    uint32_t now = ClockP_getSystemTicks();
+    uint64_t credit;
+
+    credit = (uint64_t)(now - o->scrubTick) * ClockP_getSystemTickPeriod() * o->scrubPermille + o->scrubCredit;
+    o->scrubTick = now;
+    o->scrubCredit = (credit > SCRUB_BUCKET) ? (uint32_t)SCRUB_BUCKET : (uint32_t)credit;
+}
+
+//! @brief True if <page> is inside the attached grayscale region or its shadow copy is stale
+static bool ste2007_scrub_skippage(DisplayNokia1202_Object *o, uint8_t page)
+{
+    if (o->shadowStale & (1 << page)) {
+        return true;
+    }
+    return o->gray != NULL && page >= o->gray->firstPage && page < o->gray->firstPage + o->gray->numPages;
+}
+
+//! @brief Resend one page of the shadow framebuffer
+static void ste2007_scrub_page(Display_Handle dpyH, uint8_t page)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    SPI_Transaction txn;
+
+    spitxn_reset(&(o->rowbuffer));
+    spitxn_push(&(o->rowbuffer), 0x01, &o->shadow[page * STE2007_COLUMNS], STE2007_COLUMNS);
+
+    ste2007_setxy(dpyH, 0, page);
+    ste2007_chipselect(dpyH, 0);
+    txn.count = o->rowbuffer.len;
+    txn.txBuf = (void *)(o->rowbuffer.buf);
+    txn.rxBuf = (void *)0;
+    ste2007_spitransfer(dpyH, &txn);
+    ste2007_advancecursor(dpyH, txn.count);
+    ste2007_chipselect(dpyH, 1);
+}
+
+//! @brief Resend the analog settings ste2007_open() programs, which decide whether anything is visible at all
+static void ste2007_scrub_registers(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+
+    ste2007_issue_compoundcmd(dpyH, STE2007_CMD_VOP, NOKIA1202_INIT_VOP, STE2007_MASK_VOP);
+    ste2007_issuecmd(dpyH, STE2007_CMD_SETBIAS, NOKIA1202_INIT_BIAS, STE2007_MASK_SETBIAS);
+    if (o->contrast != STE2007_SHADOW_UNKNOWN) {
+        ste2007_issuecmd(dpyH, STE2007_CMD_ELECTVOL, o->contrast, STE2007_MASK_ELECTVOL);
+    }
+}
+
+/**
+ * @brief Rewrite the next page(s) of the panel from the shadow framebuffer, within the scrubber's bandwidth budget
+ * @return DISPLAY_STATUS_SUCCESS (also when the budget did not allow any work yet), NOKIA1202_STATUS_BUSY if the
+ *         display is in use, NOKIA1202_STATUS_TIMEOUT if an SPI transfer timed out, or DISPLAY_STATUS_ERROR if the
+ *         scrubber is not enabled
+ */
+int ste2007_scrub(Display_Handle dpyH)
+{
+    DisplayNokia1202_Object *o = dpyH->object;
+    int ret, pages = 0, skipped = 0;
+
+    ret = ste2007_lock(dpyH, 0);
+    if (ret != DISPLAY_STATUS_SUCCESS) {
+        return ret;  // Foreground update in progress; the credit keeps accruing meanwhile
+    }
+    if (o->shadow == NULL || o->scrubPermille == 0) {
+        ste2007_unlock(dpyH);
+        return DISPLAY_STATUS_ERROR;
+    }
+    if (o->frameOpen) {
+        ste2007_unlock(dpyH);
+        return NOKIA1202_STATUS_BUSY;  // The shadow holds uncommitted content
+    }
+
+    ste2007_scrub_refill(o);
+    while (pages < NOKIA1202_SCRUB_MAXPAGES && skipped < STE2007_PAGES) {
+        if (ste2007_scrub_skippage(o, o->scrubPage)) {
+            skipped++;
+        } else {
+            if (o->scrubCredit < SCRUB_PAGE_WORDS * SCRUB_WORD_COST) {
+                break;
+            }
+            ste2007_scrub_page(dpyH, o->scrubPage);
+            o->scrubCredit -= SCRUB_PAGE_WORDS * SCRUB_WORD_COST;
+            pages++;
+        }
+
+        if (++o->scrubPage == STE2007_PAGES) {
+            o->scrubPage = 0;
+            // End of a pass; the registers are cheap enough to go out regardless of the remaining credit
+            ste2007_scrub_registers(dpyH);
+            o->scrubCredit = (o->scrubCredit > SCRUB_REG_WORDS * SCRUB_WORD_COST) ?
+                             o->scrubCredit - SCRUB_REG_WORDS * SCRUB_WORD_COST : 0;
+        }
+    }
+
+    return ste2007_unlock(dpyH);
+}
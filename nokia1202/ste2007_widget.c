@@ -0,0 +1,198 @@
+/**
+ * @file ste2007_widget.c
+ * @brief Nokia 1202 STE2007 TI Display Driver - Incrementally updated widgets
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Bar graph and sparkline widgets which only transmit the DDRAM columns that change between updates.
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "ste2007.h"
+#include "ste2007_widget.h"
+
+
+//! @brief Set up a bar graph; the first ste2007_bargraph_set() draws it in full
+void ste2007_bargraph_init(DisplayNokia1202_BarGraph *bg, uint8_t line, uint8_t col, uint8_t width, uint8_t fillPattern, uint8_t emptyPattern)
+{
+    if (col >= STE2007_COLUMNS) {
+        col = STE2007_COLUMNS - 1;
+    }
+    if (width > STE2007_COLUMNS - col) {
+        width = STE2007_COLUMNS - col;
+    }
+    bg->line = line;
+    bg->col = col;
+    bg->width = width;
+    bg->fillPattern = fillPattern;
+    bg->emptyPattern = emptyPattern;
+    bg->level = STE2007_SHADOW_UNKNOWN;
+}
+
+/**
+ * @brief Update a bar graph to show <value> out of <max>
+ * @details Only the columns between the previous and new fill levels are transmitted.
+ */
+void ste2007_bargraph_set(Display_Handle dpyH, DisplayNokia1202_BarGraph *bg, uint32_t value, uint32_t max)
+{
+    uint8_t level;
+
+    if (max == 0 || value >= max) {
+        level = bg->width;
+    } else {
+        level = (uint8_t)(((uint64_t)value * bg->width) / max);
+    }
+    if (level == bg->level) {
+        return;
+    }
+
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+
+    if (bg->level == STE2007_SHADOW_UNKNOWN) {
+        ste2007_setxy(dpyH, bg->col, bg->line);
+        ste2007_chipselect(dpyH, 0);
+        ste2007_writefill(dpyH, bg->fillPattern, level);
+        ste2007_writefill(dpyH, bg->emptyPattern, bg->width - level);
+        ste2007_chipselect(dpyH, 1);
+    } else if (level > bg->level) {
+        ste2007_setxy(dpyH, bg->col + bg->level, bg->line);
+        ste2007_chipselect(dpyH, 0);
+        ste2007_writefill(dpyH, bg->fillPattern, level - bg->level);
+        ste2007_chipselect(dpyH, 1);
+    } else {
+        ste2007_setxy(dpyH, bg->col + level, bg->line);
+        ste2007_chipselect(dpyH, 0);
+        ste2007_writefill(dpyH, bg->emptyPattern, bg->level - level);
+        ste2007_chipselect(dpyH, 1);
+    }
+    bg->level = level;
+
+    if (ste2007_unlock(dpyH) != DISPLAY_STATUS_SUCCESS) {
+        bg->level = STE2007_SHADOW_UNKNOWN;  // Bus timed out partway; redraw in full next time
+    }
+}
+
+
+//! @brief Set up a sparkline over <width> columns using the caller's <hist> array of <width> bytes
+void ste2007_sparkline_init(DisplayNokia1202_Sparkline *sp, uint8_t line, uint8_t col, uint8_t width, uint8_t *hist, uint8_t mode)
+{
+    if (col >= STE2007_COLUMNS) {
+        col = STE2007_COLUMNS - 1;
+    }
+    if (width > STE2007_COLUMNS - col) {
+        width = STE2007_COLUMNS - col;
+    }
+    sp->line = line;
+    sp->col = col;
+    sp->width = width;
+    sp->mode = mode;
+    sp->head = 0;
+    sp->drawn = false;
+    sp->hist = hist;
+}
+
+//! @brief Send hist[start..end] to the sparkline's <line>; caller holds the mutex
+static void ste2007_sparkline_send(Display_Handle dpyH, void *arg, uint8_t line, uint8_t start, uint8_t end)
+{
+    DisplayNokia1202_Sparkline *sp = (DisplayNokia1202_Sparkline *)arg;
+
+    ste2007_setxy(dpyH, sp->col + start, line);
+    ste2007_chipselect(dpyH, 0);
+    ste2007_write(dpyH, &sp->hist[start], end - start + 1);
+    ste2007_chipselect(dpyH, 1);
+}
+
+/**
+ * @brief Append a sample to a sparkline, scaled so <min> sits on the bottom pixel row and <max> on the top
+ * @details In NOKIA1202_SPARK_SCROLL mode the history shifts left one column and runs of columns whose byte changed are
+ *          resent (short unchanged gaps are merged into the run).  In NOKIA1202_SPARK_SWEEP mode the sample
+ *          overwrites the oldest column and only 2 columns are sent: the sample and the blank cursor ahead of it.
+ */
+void ste2007_sparkline_push(Display_Handle dpyH, DisplayNokia1202_Sparkline *sp, int32_t value, int32_t min, int32_t max)
+{
+    DisplayNokia1202_Run run;
+    uint8_t dot, b;
+    int i;
+
+    if (sp->width == 0) {
+        return;
+    }
+    if (value <= min || max <= min) {
+        dot = 0x80;
+    } else if (value >= max) {
+        dot = 0x01;
+    } else {
+        dot = 0x80 >> (uint8_t)(((int64_t)(value - min) * 7) / ((int64_t)max - min));
+    }
+
+    if (ste2007_lock(dpyH, NOKIA1202_TIMEOUT_DEFAULT) != DISPLAY_STATUS_SUCCESS) {
+        return;
+    }
+
+    if (!sp->drawn) {
+        for (i=0; i < sp->width; i++) {
+            sp->hist[i] = 0x00;
+        }
+        ste2007_setxy(dpyH, sp->col, sp->line);
+        ste2007_chipselect(dpyH, 0);
+        ste2007_writefill(dpyH, 0x00, sp->width);
+        ste2007_chipselect(dpyH, 1);
+        sp->drawn = true;
+    }
+
+    if (sp->mode == NOKIA1202_SPARK_SWEEP) {
+        sp->hist[sp->head] = dot;
+        i = sp->head + 1;
+        if (i >= sp->width) {
+            i = 0;
+        }
+        if (i > sp->head) {
+            sp->hist[i] = 0x00;
+            ste2007_sparkline_send(dpyH, sp, sp->line, sp->head, i);
+        } else {
+            ste2007_sparkline_send(dpyH, sp, sp->line, sp->head, sp->head);  // Wrapped; the cursor column is at the left edge
+            if (sp->width > 1) {
+                sp->hist[0] = 0x00;
+                ste2007_sparkline_send(dpyH, sp, sp->line, 0, 0);
+            }
+        }
+        sp->head = i;
+    } else {
+        /* Shift in place: hist[i] takes hist[i+1], which has not been overwritten yet.  Runs are flushed once the scan
+         * is past them, by which point their bytes in hist[] already hold the new values.
+         */
+        ste2007_run_init(&run, dpyH, sp->line, ste2007_sparkline_send, sp);
+        for (i=0; i < sp->width; i++) {
+            b = (i < sp->width - 1) ? sp->hist[i+1] : dot;
+            if (b != sp->hist[i]) {
+                ste2007_run_add(&run, i);
+            }
+            sp->hist[i] = b;
+        }
+        ste2007_run_flush(&run);
+    }
+
+    if (ste2007_unlock(dpyH) != DISPLAY_STATUS_SUCCESS) {
+        sp->drawn = false;  // Bus timed out partway; redraw in full next time
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * @file ste2007_widget.h
+ * @brief Nokia 1202 STE2007 TI Display Driver - Incrementally updated widgets
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Bar graph and sparkline primitives built on ste2007_setxy()/ste2007_write().  Each widget is a small struct
+ *          owned by the application which remembers what the widget currently shows on the panel, so an update only
+ *          transmits the DDRAM columns that actually change.  All functions take the display's mutex.
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOKIA1202_STE2007_WIDGET_H_
+#define NOKIA1202_STE2007_WIDGET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ti/display/Display.h>
+#include "ste2007.h"
+
+/**
+ * @brief Horizontal bar graph occupying one page (8 pixel rows) of the display
+ * @details <fillPattern> is the column byte drawn for the filled part (e.g. 0x7E) and <emptyPattern> the byte drawn
+ *          for the rest (e.g. 0x42 for an outline, 0x00 for nothing).  Bit 0 is the top pixel row of the page.
+ */
+typedef struct {
+    uint8_t line;
+    uint8_t col;
+    uint8_t width;
+    uint8_t fillPattern;
+    uint8_t emptyPattern;
+    uint8_t level;          // Filled columns currently on the panel, STE2007_SHADOW_UNKNOWN if not drawn yet
+} DisplayNokia1202_BarGraph;
+
+//! @brief Sparkline scrolls its history left one column per sample, resending only the columns that changed
+#define NOKIA1202_SPARK_SCROLL  0
+//! @brief Sparkline overwrites the oldest sample in place (oscilloscope sweep) with a blank cursor column ahead of it
+#define NOKIA1202_SPARK_SWEEP   1
+
+/**
+ * @brief Rolling trend line occupying one page (8 pixel rows) of the display
+ * @details <hist> is an application-provided array of <width> bytes holding the column bytes currently on the
+ *          panel; the widget never allocates.
+ */
+typedef struct {
+    uint8_t line;
+    uint8_t col;
+    uint8_t width;
+    uint8_t mode;
+    uint8_t head;           // NOKIA1202_SPARK_SWEEP: column the next sample lands in
+    bool drawn;
+    uint8_t *hist;
+} DisplayNokia1202_Sparkline;
+
+void ste2007_bargraph_init(DisplayNokia1202_BarGraph *, uint8_t line, uint8_t col, uint8_t width, uint8_t fillPattern, uint8_t emptyPattern);
+void ste2007_bargraph_set(Display_Handle, DisplayNokia1202_BarGraph *, uint32_t value, uint32_t max);
+
+void ste2007_sparkline_init(DisplayNokia1202_Sparkline *, uint8_t line, uint8_t col, uint8_t width, uint8_t *hist, uint8_t mode);
+void ste2007_sparkline_push(Display_Handle, DisplayNokia1202_Sparkline *, int32_t value, int32_t min, int32_t max);
+
+
+#endif /* NOKIA1202_STE2007_WIDGET_H_ */
@@ -0,0 +1,308 @@
+/**
+ * @file ste2007_bitmaptest.c
+ * @brief Nokia 1202 STE2007 TI Display Driver - Host-side golden test and benchmark for ste2007_bitmap.c
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Checks ste2007_transpose8x8() and all four rotations of ste2007_drawbitmap() against a naive per-pixel
+ *          reference, over random bitmaps of every size up to larger than the panel, random strides and random
+ *          placements (so the clipping at the right and bottom edges is covered too), then times both kernels.
+ *          The driver calls made by ste2007_drawbitmap() are replaced here by a DDRAM model, so only the TI-Drivers
+ *          headers are needed, not the RTOS:
+ *          @n    cc -O2 -I<simplelink_sdk>/source -I../nokia1202 -o ste2007_bitmaptest ste2007_bitmaptest.c ../nokia1202/ste2007_bitmap.c
+ *          @n    ./ste2007_bitmaptest [-n cases] [-i iterations]
+ *          Exits non-zero on the first mismatch, after printing the failing case.
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "ste2007.h"
+#include "ste2007_bitmap.h"
+
+#define MAX_DIM     120  // Largest bitmap side tried; bigger than the panel in both directions
+#define MAX_STRIDE  (MAX_DIM / 8 + 2)
+#define UNTOUCHED   0xA5  // Fill for DDRAM bytes the blit must not write
+
+//! @brief DDRAM model written by the stand-ins for the driver calls below
+static uint8_t ddram[STE2007_PAGES][STE2007_COLUMNS];
+static int curX, curY, csLow, locked;
+
+/* Stand-ins for the driver functions ste2007_drawbitmap() uses */
+
+int ste2007_lock(Display_Handle dpyH, uint32_t timeout)
+{
+    (void)dpyH;
+    (void)timeout;
+    locked++;
+    return DISPLAY_STATUS_SUCCESS;
+}
+
+int ste2007_unlock(Display_Handle dpyH)
+{
+    (void)dpyH;
+    locked--;
+    return DISPLAY_STATUS_SUCCESS;
+}
+
+void ste2007_setxy(Display_Handle dpyH, uint8_t x, uint8_t y)
+{
+    (void)dpyH;
+    curX = x;
+    curY = y;
+}
+
+void ste2007_chipselect(Display_Handle dpyH, uint8_t onoff)
+{
+    (void)dpyH;
+    csLow = !onoff;
+}
+
+void ste2007_write(Display_Handle dpyH, const void *buf, uint16_t len)
+{
+    const uint8_t *b = buf;
+    uint16_t i;
+
+    (void)dpyH;
+    if (!csLow || !locked) {
+        printf("write of %u bytes without chip select or lock\n", len);
+        exit(1);
+    }
+    for (i=0; i < len; i++) {
+        if (curY >= STE2007_PAGES || curX >= STE2007_COLUMNS) {
+            printf("write past the end of DDRAM at page %d column %d\n", curY, curX);
+            exit(1);
+        }
+        ddram[curY][curX] = b[i];
+        if (++curX == STE2007_COLUMNS) {
+            curX = 0;
+            curY++;
+        }
+    }
+}
+
+/* Reference implementations - one pixel at a time, straight from the definitions */
+
+static int srcpixel(const uint8_t *bmp, int w, int h, int stride, int sx, int sy)
+{
+    if (sx < 0 || sx >= w || sy < 0 || sy >= h) {
+        return 0;
+    }
+    return (bmp[sy * stride + (sx >> 3)] >> (7 - (sx & 7))) & 1;
+}
+
+static void ref_transpose(const uint8_t *rows, int stride, uint8_t cols[8])
+{
+    int j, k;
+
+    for (j=0; j < 8; j++) {
+        cols[j] = 0;
+        for (k=0; k < 8; k++) {
+            if (rows[k * stride] & (0x80 >> j)) {
+                cols[j] |= 1 << k;
+            }
+        }
+    }
+}
+
+static void ref_drawbitmap(uint8_t out[STE2007_PAGES][STE2007_COLUMNS], int x, int page, const uint8_t *bmp, int w, int h, int stride, int rotation)
+{
+    int sw, sh, X, Y, v;
+
+    sw = (rotation & 1) ? h : w;
+    sh = (rotation & 1) ? w : h;
+    if (x >= STE2007_COLUMNS || page >= STE2007_PAGES) {
+        return;
+    }
+    // Opaque over the whole pages the rotated image touches, clipped to the panel
+    for (Y=0; Y < (sh + 7) / 8 * 8 && page + Y / 8 < STE2007_PAGES; Y++) {
+        for (X=0; X < sw && x + X < STE2007_COLUMNS; X++) {
+            switch (rotation) {
+                case NOKIA1202_ROTATE_0:   v = srcpixel(bmp, w, h, stride, X, Y); break;
+                case NOKIA1202_ROTATE_90:  v = srcpixel(bmp, w, h, stride, Y, h - 1 - X); break;
+                case NOKIA1202_ROTATE_180: v = srcpixel(bmp, w, h, stride, w - 1 - X, h - 1 - Y); break;
+                default:                   v = srcpixel(bmp, w, h, stride, w - 1 - Y, X); break;
+            }
+            if (Y % 8 == 0) {
+                out[page + Y / 8][x + X] = 0;
+            }
+            out[page + Y / 8][x + X] |= (uint8_t)(v << (Y % 8));
+        }
+    }
+}
+
+static unsigned long rng = 12345;
+
+static unsigned rnd(unsigned n)
+{
+    rng = rng * 1103515245UL + 12345UL;
+    return (unsigned)((rng >> 16) & 0x7FFF) % n;
+}
+
+static const char *rotname[] = { "0", "90", "180", "270" };
+
+static int test_transpose(unsigned long cases)
+{
+    uint8_t rows[8 * 4], got[8], want[8];
+    unsigned long c;
+    int stride, i;
+
+    for (c=0; c < cases; c++) {
+        stride = 1 + rnd(4);
+        for (i=0; i < 8 * stride; i++) {
+            rows[i] = (uint8_t)rnd(256);
+        }
+        ste2007_transpose8x8(rows, (uint16_t)stride, got);
+        ref_transpose(rows, stride, want);
+        if (memcmp(got, want, 8) != 0) {
+            printf("transpose mismatch, stride %d\n", stride);
+            return 1;
+        }
+    }
+    printf("transpose8x8: %lu cases ok\n", cases);
+    return 0;
+}
+
+static int test_drawbitmap(unsigned long cases)
+{
+    static uint8_t bmp[MAX_DIM * MAX_STRIDE];
+    static uint8_t want[STE2007_PAGES][STE2007_COLUMNS];
+    unsigned long c, ok[4] = { 0, 0, 0, 0 };
+    int w, h, stride, x, page, rot, i, P, X;
+
+    for (c=0; c < cases; c++) {
+        // Mostly small images so edges and partial blocks dominate, some larger than the panel
+        w = 1 + (rnd(4) ? rnd(40) : rnd(MAX_DIM));
+        h = 1 + (rnd(4) ? rnd(40) : rnd(MAX_DIM));
+        stride = (w + 7) / 8 + rnd(2);
+        x = rnd(STE2007_COLUMNS);
+        page = rnd(STE2007_PAGES);
+        rot = rnd(4);
+        for (i=0; i < h * stride; i++) {
+            bmp[i] = (uint8_t)rnd(256);
+        }
+
+        memset(ddram, UNTOUCHED, sizeof(ddram));
+        memset(want, UNTOUCHED, sizeof(want));
+        ste2007_drawbitmap(NULL, (uint8_t)x, (uint8_t)page, bmp, (uint16_t)w, (uint16_t)h, (uint16_t)stride, (uint8_t)rot);
+        ref_drawbitmap(want, x, page, bmp, w, h, stride, rot);
+        if (locked || csLow) {
+            printf("lock or chip select left held\n");
+            return 1;
+        }
+        if (memcmp(ddram, want, sizeof(want)) != 0) {
+            for (P=0; P < STE2007_PAGES; P++) {
+                for (X=0; X < STE2007_COLUMNS; X++) {
+                    if (ddram[P][X] != want[P][X]) {
+                        printf("rotate %s: %dx%d stride %d at x %d page %d: page %d column %d is %02X, want %02X\n",
+                               rotname[rot], w, h, stride, x, page, P, X, ddram[P][X], want[P][X]);
+                        return 1;
+                    }
+                }
+            }
+        }
+        ok[rot]++;
+    }
+    printf("drawbitmap: %lu/%lu/%lu/%lu cases ok (0/90/180/270)\n", ok[0], ok[1], ok[2], ok[3]);
+    return 0;
+}
+
+static double nsper(clock_t t0, unsigned long n)
+{
+    return (double)(clock() - t0) * 1e9 / CLOCKS_PER_SEC / (double)n;
+}
+
+static void bench(unsigned long iters)
+{
+    static uint8_t bmp[68 * 12];
+    uint8_t rows[8], cols[8], sink = 0;
+    unsigned long i;
+    clock_t t0;
+    int rot;
+
+    for (i=0; i < sizeof(bmp); i++) {
+        bmp[i] = (uint8_t)rnd(256);
+    }
+    for (i=0; i < 8; i++) {
+        rows[i] = (uint8_t)rnd(256);
+    }
+
+    t0 = clock();
+    for (i=0; i < iters * 100; i++) {
+        rows[i & 7] ^= (uint8_t)i;  // Keep the compiler from hoisting the call
+        ste2007_transpose8x8(rows, 1, cols);
+        sink ^= cols[i & 7];
+    }
+    printf("transpose8x8:  %8.1f ns/block\n", nsper(t0, iters * 100));
+
+    t0 = clock();
+    for (i=0; i < iters * 100; i++) {
+        rows[i & 7] ^= (uint8_t)i;
+        ref_transpose(rows, 1, cols);
+        sink ^= cols[i & 7];
+    }
+    printf("per-pixel ref: %8.1f ns/block\n", nsper(t0, iters * 100));
+
+    for (rot=0; rot < 4; rot++) {
+        t0 = clock();
+        for (i=0; i < iters; i++) {
+            // Full panel: 96x68 for 0/180, 68x96 source for 90/270
+            if (rot & 1) {
+                ste2007_drawbitmap(NULL, 0, 0, bmp, 68, 96, 9, (uint8_t)rot);
+            } else {
+                ste2007_drawbitmap(NULL, 0, 0, bmp, 96, 68, 12, (uint8_t)rot);
+            }
+        }
+        printf("drawbitmap %3s: %8.1f us/full panel\n", rotname[rot], nsper(t0, iters) / 1000.0);
+    }
+    if (sink == 0x5A) {
+        printf("\n");
+    }
+}
+
+static void usage(const char *argv0)
+{
+    printf("usage: %s [-n cases] [-i iterations]\n", argv0);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long cases = 200000, iters = 2000;
+    int argi;
+
+    for (argi = 1; argi < argc; argi++) {
+        if (argv[argi][0] == '-' && argi + 1 < argc) {
+            switch (argv[argi][1]) {
+                case 'n': cases = strtoul(argv[++argi], NULL, 0); break;
+                case 'i': iters = strtoul(argv[++argi], NULL, 0); break;
+                default: usage(argv[0]); return 1;
+            }
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (test_transpose(cases) || test_drawbitmap(cases)) {
+        return 1;
+    }
+    bench(iters);
+    return 0;
+}
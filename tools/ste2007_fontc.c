@@ -0,0 +1,390 @@
+/**
+ * @file ste2007_fontc.c
+ * @brief Nokia 1202 STE2007 TI Display Driver - Host-side BDF font compiler
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Converts a BDF bitmap font into the page-ordered column bytes the STE2007 takes, as a header describing a
+ *          DisplayNokia1202_Font for ste2007_drawtext() (see ste2007_font.h):
+ *          @n - only the characters the application uses are kept (-c or -r), and glyphs are looked up through a
+ *               dense index table covering just that span
+ *          @n - glyphs are either a fixed cell (the font bounding box) or proportional (each glyph's DWIDTH, -p)
+ *          @n - the columns can be emitted pre-tagged as 9-bit DDRAM words (-t), so the driver sends them straight
+ *               from flash at the cost of twice the space
+ *
+ *          The font height is FONT_ASCENT + FONT_DESCENT rounded up to whole 8-pixel pages.  Any TrueType or other
+ *          outline font has to be rasterised to BDF at the wanted pixel size first (e.g. with otf2bdf).  Like
+ *          font_5x7.h, the generated header defines its tables and must be included by exactly one source file.
+ *          This is a plain C99 host program:
+ *          @n    cc -O2 -o ste2007_fontc ste2007_fontc.c
+ *          @n    ./ste2007_fontc [-n name] [-c chars | -r first-last] [-p] [-s spacing] [-t] [-o out.h] font.bdf
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// Keep in sync with ste2007.h / ste2007_font.h (the tool does not pull in the TI-Drivers headers)
+#define LCD_COLUMNS     96
+#define FONT_NOGLYPH    0xFF
+
+#define MAX_CODES       256
+#define MAX_GLYPHS      255     // FONT_NOGLYPH is reserved in the index table
+#define MAX_PAGES       9
+#define MAX_WIDTH       LCD_COLUMNS
+
+//! @brief One glyph as parsed from the BDF file
+typedef struct {
+    int present;
+    int dwidth;
+    int bbw, bbh, bbx, bby;
+    uint8_t *rows;              // bbh rows of (bbw+7)/8 bytes, MSB = leftmost pixel
+} BdfGlyph;
+
+static BdfGlyph glyphs[MAX_CODES];
+static int fbbw, fbbh, fbbx, fbby;
+static int ascent = -1, descent = -1;
+
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "Usage: %s [-n name] [-c chars | -r first-last] [-p] [-s spacing] [-t] [-o out.h] font.bdf\n", argv0);
+    fprintf(stderr, "  -n  C identifier for the font (default font)\n");
+    fprintf(stderr, "  -c  keep only these characters\n");
+    fprintf(stderr, "  -r  keep only character codes first..last (default 32-126)\n");
+    fprintf(stderr, "  -p  proportional: use each glyph's DWIDTH instead of the font bounding box width\n");
+    fprintf(stderr, "  -s  blank columns added to the right of every glyph (default 0)\n");
+    fprintf(stderr, "  -t  emit pre-tagged 9-bit DDRAM words instead of bytes\n");
+    fprintf(stderr, "  -o  output header (default stdout)\n");
+}
+
+static int hexval(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+//! @brief Read the glyphs with encodings 0-255 from a BDF file; returns 0 on success
+static int bdf_load(FILE *f, const char *path)
+{
+    char line[512];
+    int lineno = 0, code = -1, inBitmap = 0, row = 0, stride = 0, i;
+    BdfGlyph g;
+
+    memset(&g, 0, sizeof(g));
+    while (fgets(line, sizeof(line), f) != NULL) {
+        lineno++;
+        if (inBitmap) {
+            if (strncmp(line, "ENDCHAR", 7) == 0) {
+                inBitmap = 0;
+                if (code >= 0 && code < MAX_CODES) {
+                    glyphs[code] = g;
+                    glyphs[code].present = 1;
+                } else {
+                    free(g.rows);
+                }
+                memset(&g, 0, sizeof(g));
+                continue;
+            }
+            if (row >= g.bbh) {
+                continue;
+            }
+            for (i=0; i < stride; i++) {
+                int hi = hexval(line[2*i]), lo = hexval(line[2*i+1]);
+                if (hi < 0 || lo < 0) {
+                    fprintf(stderr, "%s:%d: bad BITMAP row\n", path, lineno);
+                    return 1;
+                }
+                g.rows[row * stride + i] = (uint8_t)((hi << 4) | lo);
+            }
+            row++;
+        } else if (sscanf(line, "FONTBOUNDINGBOX %d %d %d %d", &fbbw, &fbbh, &fbbx, &fbby) == 4) {
+            continue;
+        } else if (sscanf(line, "FONT_ASCENT %d", &ascent) == 1) {
+            continue;
+        } else if (sscanf(line, "FONT_DESCENT %d", &descent) == 1) {
+            continue;
+        } else if (strncmp(line, "STARTCHAR", 9) == 0) {
+            memset(&g, 0, sizeof(g));
+            code = -1;
+        } else if (sscanf(line, "ENCODING %d", &code) == 1) {
+            continue;
+        } else if (sscanf(line, "DWIDTH %d", &g.dwidth) == 1) {
+            continue;
+        } else if (sscanf(line, "BBX %d %d %d %d", &g.bbw, &g.bbh, &g.bbx, &g.bby) == 4) {
+            continue;
+        } else if (strncmp(line, "BITMAP", 6) == 0) {
+            if (g.bbw < 0 || g.bbh < 0) {
+                fprintf(stderr, "%s:%d: bad BBX\n", path, lineno);
+                return 1;
+            }
+            stride = (g.bbw + 7) / 8;
+            g.rows = calloc((size_t)(stride * g.bbh) + 1, 1);
+            if (g.rows == NULL) {
+                return 1;
+            }
+            row = 0;
+            inBitmap = 1;
+        }
+    }
+    if (fbbw <= 0 || fbbh <= 0) {
+        fprintf(stderr, "%s: no FONTBOUNDINGBOX\n", path);
+        return 1;
+    }
+    if (ascent < 0 || descent < 0) {  // Optional properties; fall back to the bounding box
+        ascent = fbbh + fbby;
+        descent = -fbby;
+    }
+    return 0;
+}
+
+//! @brief Width in columns of glyph <c> as compiled, excluding spacing
+static int glyph_width(int c, int proportional)
+{
+    int w = proportional ? glyphs[c].dwidth : fbbw;
+
+    if (w < 0) {
+        w = 0;
+    }
+    return w;
+}
+
+/**
+ * @brief Render page <p> of glyph <c> into <out> (<w> column bytes, bit 0 = top row of the page)
+ * @details Fixed-width glyphs are placed relative to the font bounding box, proportional ones relative to their own
+ *          origin.  Pixels falling outside the cell are dropped.
+ */
+static void glyph_page(int c, int p, int w, int proportional, uint8_t *out)
+{
+    const BdfGlyph *g = &glyphs[c];
+    int stride = (g->bbw + 7) / 8;
+    int r, x, cx, cy;
+
+    memset(out, 0, (size_t)w);
+    for (r=0; r < g->bbh; r++) {
+        cy = ascent - (g->bby + g->bbh) + r;
+        if (cy < p * 8 || cy >= p * 8 + 8) {
+            continue;
+        }
+        for (x=0; x < g->bbw; x++) {
+            if (!(g->rows[r * stride + x / 8] & (0x80 >> (x % 8)))) {
+                continue;
+            }
+            cx = g->bbx + x - (proportional ? 0 : fbbx);
+            if (cx >= 0 && cx < w) {
+                out[cx] |= (uint8_t)(1 << (cy - p * 8));
+            }
+        }
+    }
+}
+
+//! @brief Separator before table entry <n>, 16 entries per line
+static const char *sep(int n)
+{
+    if (n == 0) {
+        return "\n    ";
+    }
+    return (n % 16) ? ", " : ",\n    ";
+}
+
+static void emit_char(FILE *out, int c)
+{
+    if (c >= 0x20 && c < 0x7F && c != '\\') {
+        fprintf(out, " %c", c);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *name = "font", *chars = NULL, *outPath = NULL, *path = NULL;
+    int first = 32, last = 126, proportional = 0, spacing = 0, tagged = 0;
+    int want[MAX_CODES];
+    int glyphOf[MAX_CODES];
+    int argi, c, p, i, pages, nglyphs = 0, lo = -1, hi = -1, dense, defaultGlyph, col = 0, w;
+    uint8_t page[MAX_WIDTH];
+    FILE *f, *out;
+
+    for (argi = 1; argi < argc; argi++) {
+        if (argv[argi][0] == '-' && strchr("ncrso", argv[argi][1]) != NULL && argi + 1 < argc) {
+            switch (argv[argi][1]) {
+                case 'n': name = argv[++argi]; break;
+                case 'c': chars = argv[++argi]; break;
+                case 'r':
+                    if (sscanf(argv[++argi], "%i-%i", &first, &last) != 2) {
+                        usage(argv[0]);
+                        return 1;
+                    }
+                    break;
+                case 's': spacing = atoi(argv[++argi]); break;
+                case 'o': outPath = argv[++argi]; break;
+            }
+        } else if (argv[argi][0] == '-') {
+            switch (argv[argi][1]) {
+                case 'p': proportional = 1; break;
+                case 't': tagged = 1; break;
+                default: usage(argv[0]); return 1;
+            }
+        } else {
+            path = argv[argi];
+        }
+    }
+    if (path == NULL || first < 0 || last >= MAX_CODES || first > last || spacing < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+    if (bdf_load(f, path)) {
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    pages = (ascent + descent + 7) / 8;
+    if (pages < 1 || pages > MAX_PAGES) {
+        fprintf(stderr, "%s: font is %d pixels tall, at most %d supported\n", path, ascent + descent, MAX_PAGES * 8);
+        return 1;
+    }
+
+    // Pick the subset
+    for (c=0; c < MAX_CODES; c++) {
+        want[c] = chars == NULL ? (c >= first && c <= last) : 0;
+        glyphOf[c] = FONT_NOGLYPH;
+    }
+    if (chars != NULL) {
+        for (i=0; chars[i]; i++) {
+            want[(unsigned char)chars[i]] = 1;
+        }
+    }
+    for (c=0; c < MAX_CODES; c++) {
+        if (!want[c]) {
+            continue;
+        }
+        if (!glyphs[c].present) {
+            fprintf(stderr, "%s: no glyph for character %d, skipped\n", path, c);
+            continue;
+        }
+        if (nglyphs == MAX_GLYPHS) {
+            fprintf(stderr, "%s: more than %d glyphs requested\n", path, MAX_GLYPHS);
+            return 1;
+        }
+        if (glyph_width(c, proportional) + spacing > MAX_WIDTH) {
+            fprintf(stderr, "%s: character %d is wider than the panel\n", path, c);
+            return 1;
+        }
+        glyphOf[c] = nglyphs++;
+        if (lo < 0) {
+            lo = c;
+        }
+        hi = c;
+    }
+    if (nglyphs == 0) {
+        fprintf(stderr, "%s: none of the requested characters are in the font\n", path);
+        return 1;
+    }
+    dense = (hi - lo + 1 == nglyphs);
+    defaultGlyph = glyphOf['?'] != FONT_NOGLYPH ? glyphOf['?'] : (glyphOf[' '] != FONT_NOGLYPH ? glyphOf[' '] : 0);
+
+    out = stdout;
+    if (outPath != NULL) {
+        out = fopen(outPath, "w");
+        if (out == NULL) {
+            perror(outPath);
+            return 1;
+        }
+    }
+
+    fprintf(out, "/**\n * @file %s\n *\n", outPath != NULL ? outPath : "(stdout)");
+    fprintf(out, " * @details Generated by tools/ste2007_fontc from %s: %d glyphs, %d page(s) tall, %s%s.\n",
+            path, nglyphs, pages, proportional ? "proportional" : "fixed width", tagged ? ", pre-tagged" : "");
+    fprintf(out, " *          Defines its tables; include from exactly one source file.\n */\n\n");
+    fprintf(out, "#ifndef FONT_%s_H_\n#define FONT_%s_H_\n\n", name, name);
+    fprintf(out, "#include <stdint.h>\n#include \"ste2007_font.h\"\n\n");
+
+    if (!dense) {
+        fprintf(out, "const uint8_t %s_index[%d] = {", name, hi - lo + 1);
+        for (c=lo; c <= hi; c++) {
+            fprintf(out, "%s0x%02X", sep(c - lo), glyphOf[c]);
+        }
+        fprintf(out, "\n};\n\n");
+    }
+
+    if (proportional) {
+        fprintf(out, "const uint16_t %s_offset[%d] = {", name, nglyphs + 1);
+        for (c=lo, i=0; c <= hi; c++) {
+            if (glyphOf[c] == FONT_NOGLYPH) {
+                continue;
+            }
+            fprintf(out, "%s%d", sep(i++), col);
+            col += glyph_width(c, proportional) + spacing;
+        }
+        fprintf(out, "%s%d\n};\n\n", sep(i), col);
+    }
+
+    fprintf(out, "const %s %s_%s[] = {\n", tagged ? "uint16_t" : "uint8_t", name, tagged ? "tagged" : "bitmap");
+    for (c=lo, i=0; c <= hi; c++) {
+        if (glyphOf[c] == FONT_NOGLYPH) {
+            continue;
+        }
+        w = glyph_width(c, proportional) + spacing;
+        for (p=0; p < pages; p++) {
+            glyph_page(c, p, w, proportional, page);
+            fprintf(out, "   ");
+            for (col=0; col < w; col++) {
+                fprintf(out, tagged ? " 0x%03X," : " 0x%02X,", tagged ? 0x100 | page[col] : page[col]);
+            }
+            if (p == 0) {
+                fprintf(out, "  // %02X", c);
+                emit_char(out, c);
+            }
+            fprintf(out, "\n");
+        }
+        i++;
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "const DisplayNokia1202_Font %s = {\n", name);
+    fprintf(out, "    .pages = %d,\n", pages);
+    fprintf(out, "    .first = %d,\n", lo);
+    fprintf(out, "    .last = %d,\n", hi);
+    fprintf(out, "    .defaultGlyph = %d,\n", defaultGlyph);
+    fprintf(out, "    .fixedWidth = %d,\n", proportional ? 0 : fbbw + spacing);
+    fprintf(out, "    .index = %s%s,\n", dense ? "NULL" : name, dense ? "" : "_index");
+    if (proportional) {
+        fprintf(out, "    .offset = %s_offset,\n", name);
+    } else {
+        fprintf(out, "    .offset = NULL,\n");
+    }
+    fprintf(out, "    .bitmap = %s%s,\n", tagged ? "NULL" : name, tagged ? "" : "_bitmap");
+    fprintf(out, "    .tagged = %s%s\n", tagged ? name : "NULL", tagged ? "_tagged" : "");
+    fprintf(out, "};\n\n#endif /* FONT_%s_H_ */\n", name);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    for (c=0; c < MAX_CODES; c++) {
+        free(glyphs[c].rows);
+    }
+    return 0;
+}
@@ -0,0 +1,591 @@
+/**
+ * @file ste2007_latency.c
+ * @brief Nokia 1202 STE2007 TI Display Driver - Host-side worst-case bus time measurement
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Runs the real driver (ste2007.c and the drawing modules next to it) against stand-ins for the TI-Drivers
+ *          and DPL calls it makes, drives each entry point that takes the display's mutex through its worst cases
+ *          (shadowed controller state forgotten, every lineClearMode, longest strings, full-panel bitmaps, grayscale
+ *          regions, frames and canvas pans, ...) and reports the most 9-bit words any one call put on the bus while
+ *          holding the mutex.  These are the figures quoted in ste2007.h; rerun this after changing what an operation
+ *          sends.
+ *
+ *          ste2007.c is compiled into this file so that its XDC includes (System_printf in an error path) can be
+ *          satisfied without the XDC target setup; the TI-Drivers headers come from the SimpleLink SDK:
+ *          @n    cc -O2 -I<simplelink_sdk>/source -I<simplelink_sdk>/kernel/tirtos/packages -I<xdctools>/packages
+ *          @n       -I../nokia1202 -o ste2007_latency ste2007_latency.c ../nokia1202/ste2007_gray.c ../nokia1202/spitxn.c
+ *          @n       ../nokia1202/ste2007_bitmap.c ../nokia1202/ste2007_font.c ../nokia1202/ste2007_widget.c
+ *          @n       ../nokia1202/ste2007_canvas.c
+ *          @n    ./ste2007_latency [-b bitrate_hz]
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// Only System_printf/System_flush are used from these, in the mutex creation failure path
+#define xdc_runtime_System__include
+#define ti_sysbios_BIOS__include
+#define System_printf printf
+#define System_flush() fflush(stdout)
+
+#include "ste2007.c"
+#include "ste2007_bitmap.h"
+#include "ste2007_font.h"
+#include "ste2007_widget.h"
+#include "ste2007_canvas.h"
+
+
+/* Stand-ins for the TI-Drivers and DPL calls made by the driver; only SPI_transfer() does any real work */
+
+static unsigned long busWords, busXfers, csCycles;
+static int semCount[4], semUsed;
+static int clockDummy;
+
+void SPI_init(void)
+{
+}
+
+void SPI_Params_init(SPI_Params *params)
+{
+    memset(params, 0, sizeof(*params));
+}
+
+SPI_Handle SPI_open(uint_least8_t index, SPI_Params *params)
+{
+    (void)index;
+    (void)params;
+    return (SPI_Handle)&clockDummy;
+}
+
+void SPI_close(SPI_Handle handle)
+{
+    (void)handle;
+}
+
+bool SPI_transfer(SPI_Handle handle, SPI_Transaction *transaction)
+{
+    (void)handle;
+    busWords += transaction->count;
+    busXfers++;
+    return true;
+}
+
+void GPIO_init(void)
+{
+}
+
+void GPIO_write(uint_least8_t index, unsigned int value)
+{
+    if (index == 0 && value == 0) {
+        csCycles++;  // csPin is 0 in the HWAttrs below
+    }
+}
+
+int_fast16_t GPIO_setConfig(uint_least8_t index, GPIO_PinConfig pinConfig)
+{
+    (void)index;
+    (void)pinConfig;
+    return 0;
+}
+
+SemaphoreP_Handle SemaphoreP_createBinary(unsigned int count)
+{
+    if (semUsed >= (int)(sizeof(semCount) / sizeof(semCount[0]))) {
+        return NULL;
+    }
+    semCount[semUsed] = count;
+    return (SemaphoreP_Handle)&semCount[semUsed++];
+}
+
+void SemaphoreP_delete(SemaphoreP_Handle handle)
+{
+    (void)handle;
+}
+
+SemaphoreP_Status SemaphoreP_pend(SemaphoreP_Handle handle, uint32_t timeout)
+{
+    int *s = (int *)handle;
+
+    (void)timeout;
+    if (*s == 0) {
+        return SemaphoreP_TIMEOUT;  // Single threaded: nothing could ever post it
+    }
+    (*s)--;
+    return SemaphoreP_OK;
+}
+
+void SemaphoreP_post(SemaphoreP_Handle handle)
+{
+    *(int *)handle = 1;
+}
+
+void ClockP_Params_init(ClockP_Params *params)
+{
+    memset(params, 0, sizeof(*params));
+}
+
+ClockP_Handle ClockP_create(ClockP_Fxn clockFxn, uint32_t timeout, ClockP_Params *params)
+{
+    (void)clockFxn;
+    (void)timeout;
+    (void)params;
+    return (ClockP_Handle)&clockDummy;
+}
+
+void ClockP_delete(ClockP_Handle handle)
+{
+    (void)handle;
+}
+
+void ClockP_stop(ClockP_Handle handle)
+{
+    (void)handle;
+}
+
+uint32_t ClockP_getSystemTicks(void)
+{
+    return 0;
+}
+
+uint32_t ClockP_getSystemTickPeriod(void)
+{
+    return 1000;
+}
+
+int SystemP_vsnprintf(char *buf, size_t n, const char *format, va_list va)
+{
+    return vsnprintf(buf, n, format, va);
+}
+
+
+/* Measurement */
+
+static uint8_t shadowBuf[NOKIA1202_SHADOW_SIZE];
+static const DisplayNokia1202_HWAttrsV1 hwAttrs = {
+    .spiBus = 0,
+    .csPin = 0,
+    .backlightPin = 1,
+    .useBacklight = true,
+    .shadowBuf = shadowBuf,
+};
+static DisplayNokia1202_Object object;
+static Display_Config config = { &DisplayNokia1202_FxnTable, &object, &hwAttrs };
+
+//! @brief Worst case seen for one entry point
+typedef struct {
+    const char *name;
+    unsigned long words;
+    unsigned long xfers;
+    unsigned long cs;
+    char worst[64];
+} Row;
+
+enum {
+    ROW_CLEAR, ROW_CLEARLINES, ROW_PRINTF, ROW_CONTROL, ROW_CONTROL_SMALL, ROW_SCALED, ROW_BITMAP, ROW_TEXT,
+    ROW_NUMFIELD, ROW_BARGRAPH, ROW_SPARKLINE, ROW_CANVAS_SHOW, ROW_CANVAS_PAN, ROW_CANVAS_UPDATE, ROW_CANVAS_HIDE,
+    ROW_COUNT
+};
+static Row rows[ROW_COUNT] = {
+    { "clear", 0, 0, 0, "" },
+    { "clearLines", 0, 0, 0, "" },
+    { "printf", 0, 0, 0, "" },
+    { "control", 0, 0, 0, "" },
+    { "control (other)", 0, 0, 0, "" },
+    { "printscaled", 0, 0, 0, "" },
+    { "drawbitmap", 0, 0, 0, "" },
+    { "drawtext 5x7", 0, 0, 0, "" },
+    { "printint/fixed", 0, 0, 0, "" },
+    { "bargraph_set", 0, 0, 0, "" },
+    { "sparkline_push", 0, 0, 0, "" },
+    { "canvas_show", 0, 0, 0, "" },
+    { "canvas_pan", 0, 0, 0, "" },
+    { "canvas_update", 0, 0, 0, "" },
+    { "canvas_hide", 0, 0, 0, "" }
+};
+
+//! @brief Forget every shadowed register so the next call pays for the full cursor and command sequences
+static void start(Display_Handle h)
+{
+    ste2007_invalidate(h);
+    busWords = 0;
+    busXfers = 0;
+    csCycles = 0;
+}
+
+static void finish(Row *r, const char *what)
+{
+    if (busWords > r->words) {
+        r->words = busWords;
+        r->xfers = busXfers;
+        r->cs = csCycles;
+        snprintf(r->worst, sizeof(r->worst), "%s", what);
+    }
+}
+
+//! @brief Fill the whole panel (and the shadow) with <pattern> outside of any frame
+static void fill(Display_Handle h, uint8_t pattern)
+{
+    uint8_t p;
+
+    ste2007_lock(h, SemaphoreP_NO_WAIT);
+    for (p=0; p < STE2007_PAGES; p++) {
+        ste2007_setxy(h, 0, p);
+        ste2007_chipselect(h, 0);
+        ste2007_writefill(h, pattern, STE2007_COLUMNS);
+        ste2007_chipselect(h, 1);
+    }
+    ste2007_unlock(h);
+}
+
+static void measure_clears(Display_Handle h)
+{
+    char what[64];
+    uint8_t s, e;
+
+    start(h);
+    ste2007_clear_timeout(h, SemaphoreP_NO_WAIT);
+    finish(&rows[ROW_CLEAR], "whole panel");
+
+    for (s=0; s < STE2007_PAGES; s++) {
+        for (e=0; e < STE2007_PAGES + 2; e++) {
+            start(h);
+            ste2007_clearLines_timeout(h, SemaphoreP_NO_WAIT, s, e);
+            snprintf(what, sizeof(what), "lines %u-%u", s, e);
+            finish(&rows[ROW_CLEARLINES], what);
+        }
+    }
+}
+
+static void measure_printf(Display_Handle h)
+{
+    static const Display_LineClearMode modes[] = { DISPLAY_CLEAR_NONE, DISPLAY_CLEAR_LEFT, DISPLAY_CLEAR_RIGHT, DISPLAY_CLEAR_BOTH };
+    static const char *modeNames[] = { "NONE", "LEFT", "RIGHT", "BOTH" };
+    static const uint8_t cols[] = { 0, 1, 17, 48, 90, 95, 96 };
+    char what[64];
+    unsigned m, c;
+    uint8_t line;
+
+    for (m=0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        object.lineClearMode = modes[m];
+        for (line=0; line < STE2007_PAGES; line++) {
+            for (c=0; c < sizeof(cols); c++) {
+                start(h);
+                ste2007_printf_timeout(h, SemaphoreP_NO_WAIT, line, cols[c], "%s",
+                                       "WWWWWWWWWWWWWWWWWWWWWWWWWWWWWWWWWWWWWWWW");  // Longer than dispStr
+                snprintf(what, sizeof(what), "CLEAR_%s, line %u col %u", modeNames[m], line, cols[c]);
+                finish(&rows[ROW_PRINTF], what);
+            }
+        }
+    }
+    object.lineClearMode = DISPLAY_CLEAR_NONE;
+}
+
+//! @brief Every command with arguments that make it send something, from a forgotten state
+static void measure_control_small(Display_Handle h)
+{
+    static const uint8_t rates[] = { 65, 70, 75, 80 };
+    char what[64];
+    uint8_t v;
+    unsigned i;
+
+    for (v=0; v < 32; v++) {
+        start(h);
+        ste2007_control_timeout(h, SemaphoreP_NO_WAIT, NOKIA1202_CMD_CONTRAST, &v);
+        finish(&rows[ROW_CONTROL_SMALL], "CONTRAST");
+    }
+    for (i=0; i < sizeof(rates); i++) {
+        start(h);
+        ste2007_control_timeout(h, SemaphoreP_NO_WAIT, NOKIA1202_CMD_REFRESHRATE, (void *)&rates[i]);
+        finish(&rows[ROW_CONTROL_SMALL], "REFRESHRATE");
+    }
+    for (v=0; v < 2; v++) {
+        start(h);
+        ste2007_control_timeout(h, SemaphoreP_NO_WAIT, NOKIA1202_CMD_INVERT, &v);
+        finish(&rows[ROW_CONTROL_SMALL], "INVERT");
+        start(h);
+        ste2007_control_timeout(h, SemaphoreP_NO_WAIT, NOKIA1202_CMD_POWERSAVE, &v);
+        finish(&rows[ROW_CONTROL_SMALL], "POWERSAVE");
+        start(h);
+        ste2007_control_timeout(h, SemaphoreP_NO_WAIT, NOKIA1202_CMD_BACKLIGHT, &v);
+        finish(&rows[ROW_CONTROL_SMALL], "BACKLIGHT");
+    }
+    for (v=0; v <= NOKIA1202_ORIENT_ROTATE180; v++) {
+        start(h);
+        ste2007_control_timeout(h, SemaphoreP_NO_WAIT, NOKIA1202_CMD_ORIENTATION, &v);
+        snprintf(what, sizeof(what), "ORIENTATION %u", v);
+        finish(&rows[ROW_CONTROL_SMALL], what);
+    }
+}
+
+static void measure_gray(Display_Handle h)
+{
+    static uint8_t hi[NOKIA1202_SHADOW_SIZE], lo[NOKIA1202_SHADOW_SIZE];
+    static const uint8_t shapes[][2] = { { 0, 96 }, { 1, 95 }, { 0, 95 }, { 48, 48 }, { 95, 1 } };  // col, width
+    DisplayNokia1202_Gray g;
+    char what[64];
+    unsigned s, i;
+
+    for (i=0; i < sizeof(hi); i++) {
+        hi[i] = 0xF0;  // Every page gray
+        lo[i] = 0x3C;
+    }
+    for (s=0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        g.firstPage = 0;
+        g.numPages = STE2007_PAGES;
+        g.col = shapes[s][0];
+        g.width = shapes[s][1];
+        g.divisor = 1;
+        g.planeHi = hi;
+        g.planeLo = lo;
+
+        start(h);
+        ste2007_control_timeout(h, SemaphoreP_NO_WAIT, NOKIA1202_CMD_GRAYSCALE, &g);
+        snprintf(what, sizeof(what), "GRAYSCALE attach, col %u width %u", g.col, g.width);
+        finish(&rows[ROW_CONTROL], what);
+
+        start(h);
+        ste2007_control_timeout(h, SemaphoreP_NO_WAIT, NOKIA1202_CMD_GRAYSCALE, NULL);
+        snprintf(what, sizeof(what), "GRAYSCALE detach, col %u width %u", g.col, g.width);
+        finish(&rows[ROW_CONTROL], what);
+    }
+}
+
+static void measure_frame(Display_Handle h)
+{
+    static const uint8_t spans[][2] = { { 0, 95 }, { 4, 95 }, { 0, 91 }, { 2, 93 }, { 0, 0 }, { 95, 95 } };  // lo, hi
+    uint8_t buf[STE2007_COLUMNS];
+    char what[64];
+    unsigned s, step;
+    uint8_t p;
+
+    memset(buf, 0x55, sizeof(buf));
+    for (s=0; s < sizeof(spans) / sizeof(spans[0]); s++) {
+        for (step=1; step <= 2; step++) {  // Every page, then every other page
+            fill(h, 0x00);
+            ste2007_control_timeout(h, SemaphoreP_NO_WAIT, NOKIA1202_CMD_FRAMEBEGIN, NULL);
+            ste2007_lock(h, SemaphoreP_NO_WAIT);
+            for (p=0; p < STE2007_PAGES; p += step) {
+                ste2007_setxy(h, spans[s][0], p);
+                ste2007_chipselect(h, 0);
+                ste2007_write(h, buf, spans[s][1] - spans[s][0] + 1);
+                ste2007_chipselect(h, 1);
+            }
+            ste2007_unlock(h);
+
+            start(h);
+            ste2007_control_timeout(h, SemaphoreP_NO_WAIT, NOKIA1202_CMD_FRAMECOMMIT, NULL);
+            snprintf(what, sizeof(what), "FRAMECOMMIT, columns %u-%u of %s page", spans[s][0], spans[s][1],
+                     (step == 1) ? "every" : "every other");
+            finish(&rows[ROW_CONTROL], what);
+        }
+    }
+}
+
+static void measure_scaled(Display_Handle h)
+{
+    static const uint8_t cols[] = { 0, 1, 48, 95 };
+    char what[64];
+    uint8_t scale, line;
+    unsigned c;
+
+    for (scale=1; scale <= NOKIA1202_SCALE_MAX + 1; scale++) {
+        for (line=0; line < STE2007_PAGES; line++) {
+            for (c=0; c < sizeof(cols); c++) {
+                start(h);
+                ste2007_printscaled(h, line, cols[c], scale, "%s", "WWWWWWWWWWWWWWWWWWWWWWWW");
+                snprintf(what, sizeof(what), "scale %u, line %u col %u", scale, line, cols[c]);
+                finish(&rows[ROW_SCALED], what);
+            }
+        }
+    }
+}
+
+static void measure_bitmap(Display_Handle h)
+{
+    static uint8_t bmp[12 * 96];
+    char what[64];
+    uint8_t rot, x, page;
+
+    memset(bmp, 0xA5, sizeof(bmp));
+    for (rot=NOKIA1202_ROTATE_0; rot <= NOKIA1202_ROTATE_270; rot++) {
+        for (x=0; x < 2; x++) {
+            for (page=0; page < 2; page++) {
+                start(h);
+                if (rot == NOKIA1202_ROTATE_90 || rot == NOKIA1202_ROTATE_270) {
+                    ste2007_drawbitmap(h, x, page, bmp, 72, 96, 9, rot);  // Source is 72 wide, 96 tall
+                } else {
+                    ste2007_drawbitmap(h, x, page, bmp, 96, 72, 12, rot);
+                }
+                snprintf(what, sizeof(what), "full panel, rotation %u, x %u page %u", rot, x, page);
+                finish(&rows[ROW_BITMAP], what);
+            }
+        }
+    }
+}
+
+static void measure_text(Display_Handle h)
+{
+    static const uint8_t cols[] = { 0, 1, 48, 95 };
+    char what[64];
+    uint8_t line;
+    unsigned c;
+
+    for (line=0; line < STE2007_PAGES; line++) {
+        for (c=0; c < sizeof(cols); c++) {
+            start(h);
+            ste2007_drawtext(h, &ste2007_font5x7, line, cols[c], "WWWWWWWWWWWWWWWWWWWWWWWW");
+            snprintf(what, sizeof(what), "line %u col %u", line, cols[c]);
+            finish(&rows[ROW_TEXT], what);
+        }
+    }
+}
+
+static void measure_widgets(Display_Handle h)
+{
+    static uint8_t hist[STE2007_COLUMNS];
+    DisplayNokia1202_NumField f;
+    DisplayNokia1202_BarGraph bg;
+    DisplayNokia1202_Sparkline sp;
+    uint8_t mode;
+    int i;
+
+    // A field redrawn in full: every cell differs from what it showed
+    ste2007_numfield_init(&f, 0, 0, NOKIA1202_NUMFIELD_MAXWIDTH, ' ');
+    start(h);
+    ste2007_printint(h, &f, -2147483647 - 1);
+    finish(&rows[ROW_NUMFIELD], "printint, 16-wide field, first draw");
+    ste2007_numfield_init(&f, 8, 0, NOKIA1202_NUMFIELD_MAXWIDTH, '0');
+    start(h);
+    ste2007_printfixed(h, &f, -2147483647 - 1, 16, 4);
+    finish(&rows[ROW_NUMFIELD], "printfixed, 16-wide field, first draw");
+
+    ste2007_bargraph_init(&bg, 0, 0, STE2007_COLUMNS, 0xFF, 0x00);
+    start(h);
+    ste2007_bargraph_set(h, &bg, 0, 100);
+    finish(&rows[ROW_BARGRAPH], "96 wide, first draw");
+    start(h);
+    ste2007_bargraph_set(h, &bg, 100, 100);
+    finish(&rows[ROW_BARGRAPH], "96 wide, empty to full");
+
+    for (mode=NOKIA1202_SPARK_SCROLL; mode <= NOKIA1202_SPARK_SWEEP; mode++) {
+        ste2007_sparkline_init(&sp, 0, 0, STE2007_COLUMNS, hist, mode);
+        start(h);
+        ste2007_sparkline_push(h, &sp, 0, 0, 7);
+        finish(&rows[ROW_SPARKLINE], (mode == NOKIA1202_SPARK_SCROLL) ? "scroll, first draw" : "sweep, first draw");
+        for (i=0; i < 4 * STE2007_COLUMNS; i++) {
+            start(h);
+            ste2007_sparkline_push(h, &sp, (i % 5 == 0) ? 7 : 0, 0, 7);  // Changed columns spaced just past the merge gap
+            finish(&rows[ROW_SPARKLINE], (mode == NOKIA1202_SPARK_SCROLL) ? "scroll, isolated spikes" : "sweep");
+            start(h);
+            ste2007_sparkline_push(h, &sp, i % 8, 0, 7);
+            finish(&rows[ROW_SPARKLINE], (mode == NOKIA1202_SPARK_SCROLL) ? "scroll, sawtooth" : "sweep");
+        }
+    }
+}
+
+static void measure_canvas(Display_Handle h)
+{
+    static uint8_t buf[32 * 160];
+    static const int dxs[] = { 0, 1, -1, 5, -5, 64, -64 };
+    DisplayNokia1202_Canvas cv;
+    char what[64];
+    unsigned i, d;
+    int dy;
+
+    srand(1);
+    for (i=0; i < sizeof(buf); i++) {
+        buf[i] = (uint8_t)rand();
+    }
+    ste2007_canvas_init(&cv, buf, 160, 32);
+
+    start(h);
+    ste2007_canvas_show(h, &cv);
+    finish(&rows[ROW_CANVAS_SHOW], "random canvas");
+
+    for (dy=-STE2007_PAGES; dy <= STE2007_PAGES; dy++) {
+        for (d=0; d < sizeof(dxs) / sizeof(dxs[0]); d++) {
+            ste2007_canvas_pan(h, &cv, 64, 12);
+            start(h);
+            ste2007_canvas_pan(h, &cv, 64 + dxs[d], 12 + dy);
+            snprintf(what, sizeof(what), "random canvas, %d pages, %d columns", dy, dxs[d]);
+            finish(&rows[ROW_CANVAS_PAN], what);
+        }
+    }
+
+    start(h);
+    ste2007_canvas_update(h, &cv, cv.viewPage, 0, cv.width);
+    finish(&rows[ROW_CANVAS_UPDATE], "a whole canvas page");
+
+    // Two mutex holds (start line, then Display_clear()); the bigger is the clear
+    start(h);
+    ste2007_canvas_hide(h, &cv);
+    finish(&rows[ROW_CANVAS_HIDE], "both holds together");
+}
+
+static void usage(const char *argv0)
+{
+    printf("usage: %s [-b bitrate_hz]\n", argv0);
+}
+
+int main(int argc, char *argv[])
+{
+    Display_Handle h = &config;
+    Display_Params params = { .lineClearMode = DISPLAY_CLEAR_NONE };
+    unsigned long bitrate = NOKIA1202_SPI_BITRATE;
+    int argi, r;
+
+    for (argi = 1; argi < argc; argi++) {
+        if (argv[argi][0] == '-' && argv[argi][1] == 'b' && argi + 1 < argc) {
+            bitrate = strtoul(argv[++argi], NULL, 0);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (bitrate == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    DisplayNokia1202_FxnTable.initFxn(h);
+    if (DisplayNokia1202_FxnTable.openFxn(h, &params) == NULL) {
+        printf("open failed\n");
+        return 1;
+    }
+
+    measure_clears(h);
+    measure_printf(h);
+    measure_control_small(h);
+    measure_gray(h);
+    measure_frame(h);
+    measure_scaled(h);
+    measure_bitmap(h);
+    measure_text(h);
+    measure_widgets(h);
+    measure_canvas(h);
+
+    printf("Worst-case bus time with the mutex held at %lu Hz (9 bits per word):\n", bitrate);
+    printf("%-16s %6s %9s %6s %4s  %s\n", "operation", "words", "us", "xfers", "CS", "worst case");
+    for (r=0; r < ROW_COUNT; r++) {
+        printf("%-16s %6lu %9.1f %6lu %4lu  %s\n", rows[r].name, rows[r].words, rows[r].words * 9.0e6 / bitrate,
+               rows[r].xfers, rows[r].cs, rows[r].worst);
+    }
+    return 0;
+}
@@ -0,0 +1,306 @@
+/**
+ * @file ste2007_trace.c
+ * @brief Nokia 1202 STE2007 TI Display Driver - Host-side SPI trace analyzer
+ * @author Eric Brundick
+ * @date 2018
+ * @version 100
+ *
+ * @details Replays an SPI trace captured by the driver (built with NOKIA1202_TRACE, ring attached through
+ *          Display_control(NOKIA1202_CMD_TRACE)) against a model of the STE2007 cursor and DDRAM, and reports where
+ *          bus bandwidth is being wasted:
+ *          @n - cursor commands (LINE/COLMSB/COLLSB) that set the value the controller already had
+ *          @n - DDRAM data words that rewrite a byte with the value it already holds
+ *          @n - tiny transactions (<= N words per SPI_transfer)
+ *          @n - bus utilisation per second of capture
+ *
+ *          Input is the raw ring contents as little-endian uint16_t words in chronological order (see the
+ *          DisplayNokia1202_Trace notes in ste2007.h).  This is a plain C99 host program:
+ *          @n    cc -O2 -o ste2007_trace ste2007_trace.c
+ *          @n    ./ste2007_trace [-b bitrate_hz] [-t tick_us] [-s tiny_words] trace.bin
+ *
+ * @copyright (C) 2018 Eric Brundick spirilis at linux dot com
+ *  @n Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files
+ *  @n (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+ *  @n publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+ *  @n do so, subject to the following conditions:
+ *  @n
+ *  @n The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *  @n
+ *  @n THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  @n OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  @n BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+ *  @n OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// Keep these in sync with ste2007.h (the tool does not pull in the TI-Drivers headers)
+#define TRACE_MARK          0x8000
+#define TRACE_CS_ASSERT     0x8000
+#define TRACE_CS_RELEASE    0x8001
+#define TRACE_XFER          0x8002
+
+#define LCD_COLUMNS 96
+#define LCD_PAGES   9
+#define DDRAM_PAGES 16
+#define DDRAM_COLS  128
+
+#define MAX_SECONDS 86400
+
+//! @brief Controller model; cursor fields are -1 while unknown
+typedef struct {
+    int page;
+    int colmsb;
+    int collsb;
+    int pendingArg;  // next command word is the argument of a compound command
+    uint8_t ddram[DDRAM_PAGES][DDRAM_COLS];
+    uint8_t known[DDRAM_PAGES][DDRAM_COLS];
+} Ste2007Model;
+
+typedef struct {
+    unsigned long records, csCycles, txns, cmdTxns, dataTxns;
+    unsigned long words, cmdWords, dataWords;
+    unsigned long cursorCmds, redundantCursor;
+    unsigned long identicalData, unknownCursorData;
+    unsigned long tinyTxns, tinyWords;
+    unsigned long resyncSkipped;
+} TraceStats;
+
+static Ste2007Model model;
+static TraceStats st;
+static unsigned long bitsPerSecond[MAX_SECONDS];
+static unsigned long lastSecond;
+
+static void model_reset(Ste2007Model *m)
+{
+    m->page = -1;
+    m->colmsb = -1;
+    m->collsb = -1;
+    m->pendingArg = 0;
+    memset(m->known, 0, sizeof(m->known));
+}
+
+static int is_compound(uint16_t c)
+{
+    return (c == 0xE1 || c == 0x38 || c == 0x3D || c == 0xEF || c == 0xAD || c == 0xAC);
+}
+
+static void model_command(Ste2007Model *m, uint16_t c)
+{
+    if (m->pendingArg) {
+        m->pendingArg = 0;
+        return;
+    }
+    if ((c & 0xF0) == 0xB0) {
+        st.cursorCmds++;
+        if (m->page == (c & 0x0F)) {
+            st.redundantCursor++;
+        }
+        m->page = c & 0x0F;
+    } else if ((c & 0xF8) == 0x10) {
+        st.cursorCmds++;
+        if (m->colmsb == (c & 0x07)) {
+            st.redundantCursor++;
+        }
+        m->colmsb = c & 0x07;
+    } else if ((c & 0xF0) == 0x00) {
+        st.cursorCmds++;
+        if (m->collsb == (c & 0x0F)) {
+            st.redundantCursor++;
+        }
+        m->collsb = c & 0x0F;
+    } else if (c == 0xE2) {
+        model_reset(m);
+    } else if (is_compound(c)) {
+        m->pendingArg = 1;
+    }
+}
+
+static void model_data(Ste2007Model *m, uint8_t d)
+{
+    int col;
+
+    if (m->page < 0 || m->colmsb < 0 || m->collsb < 0) {
+        st.unknownCursorData++;
+        return;
+    }
+    col = (m->colmsb << 4) | m->collsb;
+    if (m->known[m->page][col] && m->ddram[m->page][col] == d) {
+        st.identicalData++;
+    }
+    m->ddram[m->page][col] = d;
+    m->known[m->page][col] = 1;
+
+    // Column auto-increment wraps to the start of the next page at the panel width
+    col++;
+    if (col >= LCD_COLUMNS) {
+        col = 0;
+        m->page++;
+        if (m->page >= LCD_PAGES) {
+            m->page = -1;
+        }
+    }
+    m->colmsb = col >> 4;
+    m->collsb = col & 0x0F;
+}
+
+static void account_bits(unsigned long second, unsigned long bits)
+{
+    if (second >= MAX_SECONDS) {
+        second = MAX_SECONDS - 1;
+    }
+    bitsPerSecond[second] += bits;
+    if (second > lastSecond) {
+        lastSecond = second;
+    }
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "Usage: %s [-b bitrate_hz] [-t tick_us] [-s tiny_words] trace.bin\n", argv0);
+    fprintf(stderr, "  -b  SPI bit rate the capture was taken at (default 1000000)\n");
+    fprintf(stderr, "  -t  ClockP tick period in microseconds (default 1000)\n");
+    fprintf(stderr, "  -s  transactions of this many words or fewer count as tiny (default 3)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long bitrate = 1000000, tickUs = 1000, tiny = 3;
+    const char *path = NULL;
+    FILE *f;
+    uint16_t *w;
+    long fsize;
+    size_t n, i, j, count;
+    uint32_t ticks, lastTicks = 0;
+    unsigned long long elapsed = 0;
+    int first = 1, argi;
+    unsigned long wasted, s;
+
+    for (argi = 1; argi < argc; argi++) {
+        if (argv[argi][0] == '-' && argi + 1 < argc) {
+            switch (argv[argi][1]) {
+                case 'b': bitrate = strtoul(argv[++argi], NULL, 0); break;
+                case 't': tickUs = strtoul(argv[++argi], NULL, 0); break;
+                case 's': tiny = strtoul(argv[++argi], NULL, 0); break;
+                default: usage(argv[0]); return 1;
+            }
+        } else {
+            path = argv[argi];
+        }
+    }
+    if (path == NULL || bitrate == 0 || tickUs == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    fsize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    n = (size_t)fsize / 2;
+    w = malloc(n * sizeof(uint16_t) + 1);
+    if (w == NULL) {
+        fclose(f);
+        return 1;
+    }
+    for (i=0; i < n; i++) {
+        int lo = fgetc(f), hi = fgetc(f);
+        w[i] = (uint16_t)(lo | (hi << 8));
+    }
+    fclose(f);
+
+    model_reset(&model);
+
+    i = 0;
+    while (i < n) {
+        if (!(w[i] & TRACE_MARK)) {  // Wrapped ring or truncated record - skip to the next marker
+            st.resyncSkipped++;
+            i++;
+            continue;
+        }
+        if (i + 3 > n) {
+            break;
+        }
+        ticks = (uint32_t)(w[i+1] & 0x7FFF) | ((uint32_t)(w[i+2] & 0x7FFF) << 15);
+        if (first) {
+            lastTicks = ticks;
+            first = 0;
+        }
+        elapsed += (ticks - lastTicks) & 0x3FFFFFFF;  // 30-bit tick counter wraps
+        lastTicks = ticks;
+
+        st.records++;
+        if (w[i] == TRACE_CS_ASSERT) {
+            st.csCycles++;
+            i += 3;
+        } else if (w[i] == TRACE_XFER) {
+            if (i + 4 > n) {
+                break;
+            }
+            count = w[i+3];
+            if (i + 4 + count > n) {
+                break;
+            }
+            st.txns++;
+            st.words += count;
+            if (count <= tiny) {
+                st.tinyTxns++;
+                st.tinyWords += count;
+            }
+            if (count > 0 && (w[i+4] & 0x100)) {
+                st.dataTxns++;
+            } else {
+                st.cmdTxns++;
+            }
+            for (j=0; j < count; j++) {
+                uint16_t v = w[i+4+j];
+                if (v & 0x100) {
+                    st.dataWords++;
+                    model_data(&model, (uint8_t)v);
+                } else {
+                    st.cmdWords++;
+                    model_command(&model, v);
+                }
+            }
+            account_bits((unsigned long)(elapsed * tickUs / 1000000ULL), count * 9UL);
+            i += 4 + count;
+        } else {
+            i += 3;
+        }
+    }
+    free(w);
+
+    wasted = st.redundantCursor + st.identicalData;
+    printf("STE2007 SPI trace: %s\n", path);
+    printf("  records              %lu (%lu words skipped resyncing)\n", st.records, st.resyncSkipped);
+    printf("  chip select cycles   %lu\n", st.csCycles);
+    printf("  transactions         %lu (%lu command, %lu data)\n", st.txns, st.cmdTxns, st.dataTxns);
+    printf("  9-bit words          %lu (%lu command, %lu data)\n", st.words, st.cmdWords, st.dataWords);
+    if (st.txns) {
+        printf("  words/transaction    %.2f\n", (double)st.words / st.txns);
+    }
+    printf("\nWaste:\n");
+    printf("  redundant cursor set %lu of %lu cursor commands\n", st.redundantCursor, st.cursorCmds);
+    printf("  identical DDRAM      %lu data words rewrote an unchanged byte\n", st.identicalData);
+    printf("  unknown cursor data  %lu data words (cursor never set since reset/start of capture)\n", st.unknownCursorData);
+    printf("  tiny transactions    %lu of <= %lu words (%lu words total)\n", st.tinyTxns, tiny, st.tinyWords);
+    if (st.words) {
+        printf("  avoidable words      %lu (%.1f%% of all words)\n", wasted, 100.0 * wasted / st.words);
+    }
+
+    printf("\nBus utilisation @ %lu Hz:\n", bitrate);
+    if (!first) {
+        for (s=0; s <= lastSecond; s++) {
+            printf("  t=%5lus  %8lu bits  %6.2f%%\n", s, bitsPerSecond[s], 100.0 * bitsPerSecond[s] / bitrate);
+        }
+    }
+
+    return 0;
+}